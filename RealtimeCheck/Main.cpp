@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../Source/Diagnostics.h"
+
+//==============================================================================
+// Runs the real-time safety check of the audio thread with allocations counted,
+// and exits with 1 if any configuration failed, so a build script can stop on it.
+int main()
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    bool passed = false;
+    juce::String report = Diagnostics::checkRealtimeSafety(&passed);
+    std::cout << report << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "AudioAnalyser.h"
+
+//Pitches outside this range add more noise than harmony to the chromagram
+static constexpr double lowestFrequency = 55.0;
+static constexpr double highestFrequency = 5000.0;
+
+AudioAnalyser::AudioAnalyser() : Thread("Chord detection")
+{
+    //Every distinct diatonic triad and seventh chord of every mode
+    for (int mode = 0; mode < numModes; mode++)
+    {
+        for (int degree = 0; degree < 7; degree++)
+        {
+            for (int sevenths = 0; sevenths < 2; sevenths++)
+            {
+                juce::uint16 mask = diatonicChordMask(0, mode, degree, sevenths == 1);
+                for (int root = 0; root < 12; root++)
+                {
+                    //Rotate the mask to each root, the chord root moves with it
+                    juce::uint16 rotated = (juce::uint16)(((mask << root) | (mask >> (12 - root))) & 0xfff);
+                    int chordRootNote = pitchClass(root + modeIntervals[mode][degree]);
+                    bool known = std::any_of(chordTemplates.begin(), chordTemplates.end(),
+                        [rotated](const ChordTemplate& t) { return t.mask == rotated; });
+                    if (!known)
+                        chordTemplates.push_back({ rotated, chordRootNote, sevenths == 1 ? 4 : 3 });
+                }
+            }
+        }
+    }
+}
+
+AudioAnalyser::~AudioAnalyser()
+{
+    stopThread(1000);
+}
+
+void AudioAnalyser::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+    if (!shouldBeEnabled)
+    {
+        chordRoot = -1;
+        chordMask = 0;
+        keyRoot = -1;
+        keyMode = -1;
+    }
+}
+
+bool AudioAnalyser::isEnabled() const
+{
+    return enabled;
+}
+
+void AudioAnalyser::prepare(double newSampleRate)
+{
+    stopThread(1000);
+
+    //About 85 ms windows whatever the sample rate, so that 48 and 96 kHz resolve pitches equally well
+    sampleRate = newSampleRate;
+    int order = juce::jlimit(10, 14, (int)std::round(std::log2(sampleRate * 0.085)));
+    fftSize = 1 << order;
+    hopSize = fftSize / 4;
+    fft = std::make_unique<juce::dsp::FFT>(order);
+
+    window.resize((size_t)fftSize);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t)fftSize,
+        juce::dsp::WindowingFunction<float>::hann, false);
+    history.assign((size_t)fftSize, 0.0f);
+    fftData.assign((size_t)fftSize * 2, 0.0f);
+
+    binPitchClasses.assign((size_t)fftSize / 2 + 1, -1);
+    for (int bin = 1; bin <= fftSize / 2; bin++)
+    {
+        double frequency = bin * sampleRate / fftSize;
+        if (frequency >= lowestFrequency && frequency <= highestFrequency)
+            binPitchClasses[(size_t)bin] = pitchClass((int)std::round(69 + 12 * std::log2(frequency / 440.0)));
+    }
+
+    //Enough for any block size a host is likely to use
+    mixBuffer.assign(8192, 0.0f);
+    fifo.reset();
+    startThread();
+}
+
+void AudioAnalyser::release()
+{
+    stopThread(1000);
+}
+
+double AudioAnalyser::getLatencySeconds() const
+{
+    return sampleRate > 0 ? (fftSize + hopSize) / sampleRate : 0.0;
+}
+
+size_t AudioAnalyser::getMemoryBytes() const
+{
+    //The window, the history and the FFT buffer, which is twice as long, then the pitch class
+    //of every bin. The FFT's own tables are counted as about another FFT buffer.
+    size_t frame = sizeof(float) * (size_t)fftSize * 6 + sizeof(int) * (size_t)(fftSize / 2 + 1);
+    return frame + sizeof(float) * (fifoBuffer.size() + mixBuffer.size()) + sizeof(ChordTemplate) * chordTemplates.size();
+}
+
+void AudioAnalyser::pushSamples(const juce::AudioBuffer<float>& buffer, int numInputChannels)
+{
+    int numChannels = juce::jmin(numInputChannels, buffer.getNumChannels());
+    if (!enabled || numChannels == 0 || fftSize == 0)
+        return;
+
+    for (int start = 0; start < buffer.getNumSamples(); start += (int)mixBuffer.size())
+    {
+        int numSamples = juce::jmin((int)mixBuffer.size(), buffer.getNumSamples() - start);
+        float gain = 1.0f / numChannels;
+        juce::FloatVectorOperations::copyWithMultiply(mixBuffer.data(), buffer.getReadPointer(0, start), gain, numSamples);
+        for (int channel = 1; channel < numChannels; channel++)
+            juce::FloatVectorOperations::addWithMultiply(mixBuffer.data(), buffer.getReadPointer(channel, start), gain, numSamples);
+
+        //If the analysis thread falls behind the newest audio is dropped, never waited for
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+        juce::FloatVectorOperations::copy(fifoBuffer.data() + start1, mixBuffer.data(), size1);
+        juce::FloatVectorOperations::copy(fifoBuffer.data() + start2, mixBuffer.data() + size1, size2);
+        fifo.finishedWrite(size1 + size2);
+    }
+}
+
+void AudioAnalyser::run()
+{
+    while (!threadShouldExit())
+    {
+        if (fifo.getNumReady() < hopSize)
+        {
+            wait(5);
+            continue;
+        }
+
+        std::memmove(history.data(), history.data() + hopSize, sizeof(float) * (size_t)(fftSize - hopSize));
+        float* destination = history.data() + fftSize - hopSize;
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(hopSize, start1, size1, start2, size2);
+        juce::FloatVectorOperations::copy(destination, fifoBuffer.data() + start1, size1);
+        juce::FloatVectorOperations::copy(destination + size1, fifoBuffer.data() + start2, size2);
+        fifo.finishedRead(size1 + size2);
+
+        if (enabled)
+            analyseFrame();
+    }
+}
+
+void AudioAnalyser::analyseFrame()
+{
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+
+    juce::FloatVectorOperations::multiply(fftData.data(), history.data(), window.data(), fftSize);
+    juce::FloatVectorOperations::clear(fftData.data() + fftSize, fftSize);
+    fft->performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    float chroma[12] = {};
+    float total = 0;
+    for (int bin = 1; bin <= fftSize / 2; bin++)
+    {
+        int pc = binPitchClasses[(size_t)bin];
+        if (pc >= 0)
+        {
+            float energy = fftData[(size_t)bin] * fftData[(size_t)bin];
+            chroma[pc] += energy;
+            total += energy;
+        }
+    }
+
+    //Roughly -50 dB for a Hann windowed sine
+    float silence = (float)fftSize * 0.001f;
+    if (total < silence * silence)
+    {
+        chordRoot = -1;
+        chordMask = 0;
+    }
+    else
+    {
+        for (int pc = 0; pc < 12; pc++)
+        {
+            float normalised = chroma[pc] / total;
+            chordChroma[pc] = chordChroma[pc] * 0.5f + normalised * 0.5f;
+            keyChroma[pc] = keyChroma[pc] * 0.98f + normalised * 0.02f;
+        }
+        matchChord(chordChroma);
+        matchKey(keyChroma);
+    }
+
+    //CPU use relative to the audio it covers
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    float load = (float)(seconds * sampleRate / hopSize);
+    cpuLoad = cpuLoad * 0.95f + load * 0.05f;
+}
+
+void AudioAnalyser::matchChord(const float* chroma)
+{
+    float norm = 0;
+    for (int pc = 0; pc < 12; pc++)
+        norm += chroma[pc] * chroma[pc];
+    norm = std::sqrt(norm);
+
+    //Cosine similarity with each template, sevenths need to beat triads by a margin
+    float bestScore = 0;
+    const ChordTemplate* best = nullptr;
+    for (const ChordTemplate& t : chordTemplates)
+    {
+        float sum = 0;
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if (t.mask & (1 << pc))
+                sum += chroma[pc];
+        }
+        float score = sum / (norm * std::sqrt((float)t.numNotes)) * (t.numNotes == 4 ? 0.95f : 1.0f);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = &t;
+        }
+    }
+
+    bool confident = best != nullptr && bestScore > 0.6f;
+    chordMask = confident ? best->mask : 0;
+    chordRoot = confident ? best->root : -1;
+}
+
+void AudioAnalyser::matchKey(const float* chroma)
+{
+    int root, mode;
+    findBestScale(chroma, root, mode);
+    keyRoot = root;
+    keyMode = mode;
+}
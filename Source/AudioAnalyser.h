@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// Detects the chord and key being played into the audio input.
+//
+// The audio thread only copies a mono mix into a lock-free FIFO. A background
+// thread folds a windowed FFT of it into a 12 bin chromagram and matches that
+// against the diatonic chords and scales of every mode.
+class AudioAnalyser : private juce::Thread
+{
+public:
+    AudioAnalyser();
+    ~AudioAnalyser() override;
+
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+
+    void prepare(double sampleRate);
+    void release();
+
+    // Audio thread
+    void pushSamples(const juce::AudioBuffer<float>& buffer, int numInputChannels);
+
+    // Any thread. -1 when nothing has been detected.
+    int getChordRoot() const { return chordRoot; }
+    juce::uint16 getChordMask() const { return (juce::uint16)chordMask.load(); }
+    int getKeyRoot() const { return keyRoot; }
+    int getKeyMode() const { return keyMode; }
+
+    // Time spent analysing as a fraction of the audio analysed, i.e. of one core
+    float getCpuLoad() const { return cpuLoad; }
+    // Worst case latency from a sample arriving until it has been analysed
+    double getLatencySeconds() const;
+    // Heap memory of the buffers and tables, which depend on the sample rate
+    size_t getMemoryBytes() const;
+
+private:
+    void run() override;
+    void analyseFrame();
+    void matchChord(const float* chroma);
+    void matchKey(const float* chroma);
+
+    struct ChordTemplate
+    {
+        juce::uint16 mask;
+        int root;
+        int numNotes;
+    };
+    std::vector<ChordTemplate> chordTemplates;
+
+    static constexpr int fifoSize = 1 << 16;
+    juce::AbstractFifo fifo{ fifoSize };
+    std::vector<float> fifoBuffer = std::vector<float>(fifoSize);
+    std::vector<float> mixBuffer;
+
+    double sampleRate = 0;
+    int fftSize = 0;
+    int hopSize = 0;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> window;
+    std::vector<float> history;
+    std::vector<float> fftData;
+    std::vector<int> binPitchClasses;
+
+    float chordChroma[12] = {};
+    float keyChroma[12] = {};
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<int> chordRoot{ -1 };
+    std::atomic<int> chordMask{ 0 };
+    std::atomic<int> keyRoot{ -1 };
+    std::atomic<int> keyMode{ -1 };
+    std::atomic<float> cpuLoad{ 0 };
+};
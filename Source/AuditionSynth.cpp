@@ -0,0 +1,292 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "AuditionSynth.h"
+
+void AuditionSynth::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+bool AuditionSynth::isEnabled() const
+{
+    return enabled;
+}
+
+bool AuditionSynth::play(const Phrase& phrase)
+{
+    return enabled && phraseQueue.push(phrase);
+}
+
+float AuditionSynth::getCpuLoad() const
+{
+    return cpuLoad;
+}
+
+int AuditionSynth::getNumActiveVoices() const
+{
+    return numActiveVoices;
+}
+
+void AuditionSynth::prepare(double newSampleRate)
+{
+    //The voice pool is fixed size, preparing only resets it and works out the envelope slopes per sample
+    sampleRate = newSampleRate;
+    attackSlope = (float)(1.0 / (0.005 * sampleRate));
+    decaySlope = (float)((1.0 - sustainLevel) / (0.3 * sampleRate));
+    releaseSlope = (float)(1.0 / (0.3 * sampleRate));
+    numVoices = 0;
+    numScheduled = 0;
+    numActiveVoices = 0;
+    cpuLoad = 0;
+}
+
+void AuditionSynth::process(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi)
+{
+    //Switching off lets the sounding voices fade out rather than cutting them off with a click
+    bool fadingOut = !enabled;
+    if (fadingOut)
+    {
+        numScheduled = 0;
+        releaseAll();
+        if (numVoices == 0)
+        {
+            numActiveVoices = 0;
+            return;
+        }
+    }
+
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    int numSamples = buffer.getNumSamples();
+    if (!fadingOut)
+        startPhrases();
+
+    //Rendered in runs that end at the next note event, so every note starts on its exact sample.
+    //The raw bytes are read, a MidiMessage would allocate for long SysEx.
+    float run[runLength];
+    auto event = fadingOut ? midi.cend() : midi.cbegin();
+    for (int sample = 0; sample < numSamples;)
+    {
+        for (; event != midi.cend() && (*event).samplePosition <= sample; ++event)
+        {
+            if ((*event).numBytes < 3)
+                continue;
+            const juce::uint8* data = (*event).data;
+            int status = data[0] & 0xf0;
+            if (status == 0x90 && data[2] != 0)
+                noteOn(data[1] & 0x7f, (data[2] & 0x7f) / 127.0f);
+            else if (status == 0x80 || status == 0x90)
+                noteOff(data[1] & 0x7f);
+            else if (status == 0xb0 && data[1] == 123)
+                releaseAll();
+            else if (status == 0xb0 && data[1] == 120)
+                numVoices = 0;
+        }
+
+        int end = juce::jmin(numSamples, sample + runLength);
+        if (event != midi.cend())
+            end = juce::jmin(end, (*event).samplePosition);
+        for (int idx = numScheduled - 1; idx >= 0; idx--)
+        {
+            ScheduledNote& note = scheduled[(size_t)idx];
+            if (note.startIn == sample)
+                noteOn(note.note, 0.7f);
+            if (note.stopIn == sample)
+            {
+                noteOff(note.note);
+                scheduled[(size_t)idx] = scheduled[(size_t)--numScheduled];
+                continue;
+            }
+            if (note.startIn > sample)
+                end = juce::jmin(end, note.startIn);
+            if (note.stopIn > sample)
+                end = juce::jmin(end, note.stopIn);
+        }
+
+        updateStages();
+        int runSamples = end - sample;
+        std::fill(run, run + runSamples, 0.0f);
+        render(run, runSamples);
+        for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+            juce::FloatVectorOperations::add(buffer.getWritePointer(channel, sample), run, runSamples);
+        sample = end;
+    }
+
+    for (int idx = 0; idx < numScheduled; idx++)
+    {
+        scheduled[(size_t)idx].startIn -= numSamples;
+        scheduled[(size_t)idx].stopIn -= numSamples;
+    }
+    numActiveVoices = numVoices;
+
+    //CPU use relative to the audio it covers
+    double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    float load = numSamples > 0 ? (float)(seconds * sampleRate / numSamples) : 0.0f;
+    cpuLoad = cpuLoad * 0.95f + load * 0.05f;
+}
+
+void AuditionSynth::startPhrases()
+{
+    Phrase phrase;
+    while (phraseQueue.pop(phrase))
+    {
+        //A step of 0 starts every note at once
+        int stepSamples = juce::roundToInt(phrase.stepSeconds * sampleRate);
+        int noteSamples = juce::jmax(1, juce::roundToInt(phrase.noteSeconds * sampleRate));
+        for (int idx = 0; idx < phrase.numNotes && numScheduled < (int)scheduled.size(); idx++)
+        {
+            int startIn = idx * stepSamples;
+            scheduled[(size_t)numScheduled++] = { phrase.notes[idx], startIn, startIn + noteSamples };
+        }
+    }
+}
+
+void AuditionSynth::noteOn(int note, float velocity)
+{
+    int voice = 0;
+    while (voice < numVoices && notes[(size_t)voice] != note)
+        voice++;
+    if (voice == numVoices)
+    {
+        if (numVoices < maxVoices)
+        {
+            voice = numVoices++;
+            phases[(size_t)voice] = 0;
+            levels[(size_t)voice] = 0;
+        }
+        else
+        {
+            //Steal the quietest released voice, or else the oldest one
+            voice = 0;
+            for (int other = 1; other < numVoices; other++)
+            {
+                bool otherReleased = stages[(size_t)other] == release;
+                bool voiceReleased = stages[(size_t)voice] == release;
+                if (otherReleased && !voiceReleased)
+                    voice = other;
+                else if (otherReleased == voiceReleased && (otherReleased ? levels[(size_t)other] < levels[(size_t)voice]
+                                                                          : ages[(size_t)other] < ages[(size_t)voice]))
+                    voice = other;
+            }
+        }
+    }
+
+    //Phase runs -1..1 over a cycle
+    double frequency = 440.0 * std::pow(2.0, (note - 69) / 12.0);
+    increments[(size_t)voice] = (float)(2.0 * frequency / sampleRate);
+    gains[(size_t)voice] = voiceGain * juce::jmax(0.1f, velocity);
+    notes[(size_t)voice] = (juce::int8)note;
+    stages[(size_t)voice] = attack;
+    ages[(size_t)voice] = ++noteCounter;
+}
+
+void AuditionSynth::noteOff(int note)
+{
+    for (int voice = 0; voice < numVoices; voice++)
+    {
+        if (notes[(size_t)voice] == note)
+            stages[(size_t)voice] = release;
+    }
+}
+
+void AuditionSynth::releaseAll()
+{
+    for (int voice = 0; voice < numVoices; voice++)
+        stages[(size_t)voice] = release;
+}
+
+void AuditionSynth::updateStages()
+{
+    for (int voice = numVoices - 1; voice >= 0; voice--)
+    {
+        float& level = levels[(size_t)voice];
+        Stage& stage = stages[(size_t)voice];
+        if (stage == attack && level >= 1.0f)
+        {
+            level = 1.0f;
+            stage = decay;
+        }
+        if (stage == decay && level <= sustainLevel)
+        {
+            level = sustainLevel;
+            stage = sustain;
+        }
+        if (stage == release && level <= 0.0f)
+        {
+            removeVoice(voice);
+            continue;
+        }
+        slopes[(size_t)voice] = stage == attack ? attackSlope : stage == decay ? -decaySlope : stage == release ? -releaseSlope : 0.0f;
+    }
+}
+
+void AuditionSynth::removeVoice(int voice)
+{
+    //Voices stay packed, the last one takes the place of the one that finished
+    int last = --numVoices;
+    phases[(size_t)voice] = phases[(size_t)last];
+    increments[(size_t)voice] = increments[(size_t)last];
+    levels[(size_t)voice] = levels[(size_t)last];
+    slopes[(size_t)voice] = slopes[(size_t)last];
+    gains[(size_t)voice] = gains[(size_t)last];
+    notes[(size_t)voice] = notes[(size_t)last];
+    stages[(size_t)voice] = stages[(size_t)last];
+    ages[(size_t)voice] = ages[(size_t)last];
+}
+
+//Wraps a phase to -1..1
+static inline float wrapPhase(float x)
+{
+    return x - 2.0f * std::floor((x + 1.0f) * 0.5f);
+}
+
+//Parabolic approximation of sin(pi * x) for x in -1..1
+static inline float parabolicSine(float x)
+{
+    return 4.0f * x * (1.0f - std::abs(x));
+}
+
+void AuditionSynth::render(float* output, int numSamples)
+{
+    for (int voice = 0; voice < numVoices; voice++)
+    {
+        const float phase = phases[(size_t)voice];
+        const float increment = increments[(size_t)voice];
+        const float level = levels[(size_t)voice];
+        const float slope = slopes[(size_t)voice];
+        const float gain = gains[(size_t)voice];
+
+        //Phase and level are worked out from the sample index rather than carried from sample to sample
+        for (int idx = 0; idx < numSamples; idx++)
+        {
+            float step = (float)(idx + 1);
+            float x = wrapPhase(phase + step * increment);
+            float envelope = std::min(1.0f, std::max(0.0f, level + step * slope));
+            float tone = parabolicSine(x) + 0.3f * parabolicSine(wrapPhase(x * 2.0f));
+            output[idx] += envelope * gain * tone;
+        }
+
+        phases[(size_t)voice] = wrapPhase(phase + numSamples * increment);
+        levels[(size_t)voice] = std::min(1.0f, std::max(0.0f, level + numSamples * slope));
+    }
+}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+
+//==============================================================================
+// A small synth for hearing the circle without routing MIDI to an instrument.
+// It plays the notes on the plugin's MIDI output, i.e. the MIDI input, chord
+// progressions and voice leading, and phrases the editor asks for directly:
+// a clicked note, a chord, or a scale run.
+//
+// Voices are a fixed pool of structure-of-arrays state, kept packed so only
+// sounding voices are rendered. Each voice is rendered in runs of at most 16
+// samples in which its phase and envelope are linear in the sample index, so
+// the inner loop has no loop-carried state and the compiler can vectorise it.
+// The envelope stage only changes between runs. Nothing on the audio thread
+// allocates or locks.
+class AuditionSynth
+{
+public:
+    // Notes to start together, or one after the other if stepSeconds > 0
+    struct Phrase
+    {
+        juce::int8 notes[8];
+        juce::int8 numNotes;
+        float stepSeconds;
+        float noteSeconds;
+    };
+
+    // Message thread
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+    bool play(const Phrase& phrase);
+    float getCpuLoad() const;
+    int getNumActiveVoices() const;
+
+    // Audio thread
+    void prepare(double sampleRate);
+    void process(juce::AudioBuffer<float>& buffer, const juce::MidiBuffer& midi);
+
+    static constexpr int maxVoices = 32;
+
+private:
+    enum Stage { attack, decay, sustain, release };
+
+    void noteOn(int note, float velocity);
+    void noteOff(int note);
+    void releaseAll();
+    void startPhrases();
+    void render(float* output, int numSamples);
+    void updateStages();
+    void removeVoice(int voice);
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<float> cpuLoad{ 0 };
+    std::atomic<int> numActiveVoices{ 0 };
+    LockFreeQueue<Phrase, 16> phraseQueue;
+
+    // Voices 0..numVoices - 1 are sounding
+    int numVoices = 0;
+    std::array<float, maxVoices> phases{};      // -1..1
+    std::array<float, maxVoices> increments{};
+    std::array<float, maxVoices> levels{};
+    std::array<float, maxVoices> slopes{};
+    std::array<float, maxVoices> gains{};
+    std::array<juce::int8, maxVoices> notes{};
+    std::array<Stage, maxVoices> stages{};
+    std::array<juce::uint32, maxVoices> ages{};
+    juce::uint32 noteCounter = 0;
+
+    // Notes of phrases still to start or stop, in samples from the start of the block
+    struct ScheduledNote
+    {
+        juce::int8 note;
+        int startIn;
+        int stopIn;
+    };
+    std::array<ScheduledNote, 64> scheduled{};
+    int numScheduled = 0;
+
+    double sampleRate = 44100;
+    float attackSlope = 0, decaySlope = 0, releaseSlope = 0;
+
+    static constexpr int runLength = 16;
+    static constexpr float sustainLevel = 0.6f;
+    static constexpr float voiceGain = 0.12f;
+};
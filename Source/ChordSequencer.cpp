@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "ChordSequencer.h"
+
+ChordSequencer::ChordSequencer()
+{
+    //All 12 x 9 x 7 x 2 voicings are only a few kilobytes, so there is nothing to
+    //recompute when the root or mode changes
+    for (int root = 0; root < 12; root++)
+    {
+        for (int mode = 0; mode < numModes; mode++)
+        {
+            for (int degree = 0; degree < 7; degree++)
+            {
+                for (int sevenths = 0; sevenths < 2; sevenths++)
+                {
+                    int offsets[4];
+                    Voicing& voicing = voicings[root][mode][degree][sevenths];
+                    voicing.numNotes = (juce::int8)diatonicChordOffsets(mode, degree, sevenths == 1, offsets);
+                    int chordRoot = lowestChordRoot + pitchClass(root + offsets[0]);
+                    for (int idx = 0; idx < voicing.numNotes; idx++)
+                        voicing.notes[idx] = (juce::int8)(chordRoot + offsets[idx] - offsets[0]);
+                }
+            }
+        }
+    }
+
+    for (auto& step : steps)
+        step = 0;
+    setProgression({ 0, 3, 4, 0 });
+}
+
+void ChordSequencer::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+bool ChordSequencer::isEnabled() const
+{
+    return enabled;
+}
+
+void ChordSequencer::setProgression(const juce::Array<int>& degrees)
+{
+    //Shrink first so the audio thread never reads a step that is being written
+    int newNumSteps = juce::jmin(degrees.size(), maxSteps);
+    numSteps = juce::jmin(numSteps.load(), newNumSteps);
+    for (int idx = 0; idx < newNumSteps; idx++)
+        steps[idx] = juce::jlimit(0, 6, degrees[idx]);
+    numSteps = newNumSteps;
+}
+
+juce::Array<int> ChordSequencer::getProgression() const
+{
+    juce::Array<int> degrees;
+    for (int idx = 0; idx < numSteps; idx++)
+        degrees.add(steps[idx]);
+    return degrees;
+}
+
+void ChordSequencer::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    lastStepIndex = -1;
+}
+
+void ChordSequencer::process(juce::MidiBuffer& midi, int numSamples, juce::AudioPlayHead* playHead,
+    int root, int mode, bool sevenths)
+{
+    juce::Optional<juce::AudioPlayHead::PositionInfo> position;
+    if (playHead != nullptr)
+        position = playHead->getPosition();
+
+    bool canPlay = enabled && mode >= 0 && numSteps > 0
+        && position.hasValue() && position->getIsPlaying()
+        && position->getPpqPosition().hasValue() && position->getBpm().hasValue();
+    if (!canPlay)
+    {
+        stop(midi, 0);
+        return;
+    }
+
+    //One chord per bar
+    double beatsPerStep = 4.0;
+    if (auto timeSignature = position->getTimeSignature())
+        beatsPerStep = timeSignature->numerator * 4.0 / timeSignature->denominator;
+
+    double samplesPerBeat = sampleRate * 60.0 / *position->getBpm();
+    double ppqStart = *position->getPpqPosition();
+    double ppqEnd = ppqStart + numSamples / samplesPerBeat;
+
+    //Jumps and loops restart whichever step the playhead landed in
+    auto stepIndex = (juce::int64)std::floor(ppqStart / beatsPerStep);
+    if (stepIndex != lastStepIndex)
+        startStep(midi, stepIndex, 0, root, mode, sevenths);
+
+    for (double boundary = (stepIndex + 1) * beatsPerStep; boundary < ppqEnd; boundary += beatsPerStep)
+    {
+        int sampleOffset = juce::jlimit(0, numSamples - 1, (int)((boundary - ppqStart) * samplesPerBeat));
+        startStep(midi, ++stepIndex, sampleOffset, root, mode, sevenths);
+    }
+}
+
+void ChordSequencer::stop(juce::MidiBuffer& midi, int sampleOffset)
+{
+    for (int idx = 0; idx < numPlayingNotes; idx++)
+        midi.addEvent(juce::MidiMessage::noteOff(midiChannel, playingNotes[idx]), sampleOffset);
+    numPlayingNotes = 0;
+    lastStepIndex = -1;
+}
+
+void ChordSequencer::startStep(juce::MidiBuffer& midi, juce::int64 stepIndex, int sampleOffset, int root, int mode, bool sevenths)
+{
+    stop(midi, sampleOffset);
+    lastStepIndex = stepIndex;
+
+    int stepCount = numSteps;
+    if (stepCount == 0)
+        return;
+
+    int degree = steps[(int)(((stepIndex % stepCount) + stepCount) % stepCount)];
+    const Voicing& voicing = voicings[pitchClass(root)][mode][degree][sevenths ? 1 : 0];
+    for (int idx = 0; idx < voicing.numNotes; idx++)
+    {
+        playingNotes[idx] = voicing.notes[idx];
+        midi.addEvent(juce::MidiMessage::noteOn(midiChannel, playingNotes[idx], (juce::uint8)100), sampleOffset);
+    }
+    numPlayingNotes = voicing.numNotes;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// Plays a progression of diatonic degrees of the selected root and mode as MIDI
+// chords, one chord per bar, following the host transport.
+//
+// The voicing of every degree of every root and mode is worked out up front, and
+// the progression lives in atomics, so process() never allocates or locks.
+class ChordSequencer
+{
+public:
+    static constexpr int maxSteps = 16;
+
+    ChordSequencer();
+
+    // Message thread
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+    void setProgression(const juce::Array<int>& degrees);
+    juce::Array<int> getProgression() const;
+
+    // Audio thread
+    void prepare(double newSampleRate);
+    void process(juce::MidiBuffer& midi, int numSamples, juce::AudioPlayHead* playHead,
+        int root, int mode, bool sevenths);
+    void stop(juce::MidiBuffer& midi, int sampleOffset);
+
+private:
+    void startStep(juce::MidiBuffer& midi, juce::int64 stepIndex, int sampleOffset, int root, int mode, bool sevenths);
+
+    struct Voicing
+    {
+        juce::int8 notes[4];
+        juce::int8 numNotes;
+    };
+    // [root][mode][degree][triad / seventh]
+    Voicing voicings[12][numModes][7][2];
+
+    std::atomic<bool> enabled{ false };
+    std::atomic<int> numSteps{ 0 };
+    std::atomic<int> steps[maxSteps];
+
+    double sampleRate = 44100.0;
+    juce::int64 lastStepIndex = -1;
+    int playingNotes[4];
+    int numPlayingNotes = 0;
+
+    static constexpr int midiChannel = 1;
+    static constexpr int lowestChordRoot = 48;
+};
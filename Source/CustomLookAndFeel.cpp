@@ -81,6 +81,33 @@ void CustomLookAndFeel::setDarkModeLookAndFeel()
     setColour(Slider::backgroundColourId, darkModeBackgroundColour);
 }
 
+void CustomLookAndFeel::setThemeLookAndFeel(const Theme& theme)
+{
+    Colour selectedBackground = theme.paper.interpolatedWith(theme.ink, 0.25f);
+    setColour(TextButton::textColourOnId, theme.ink);
+    setColour(TextButton::textColourOffId, theme.ink);
+    setColour(TextButton::buttonColourId, theme.paper);
+    setColour(TextButton::buttonOnColourId, selectedBackground);
+    setColour(Label::textColourId, theme.ink);
+    setColour(Label::backgroundColourId, selectedBackground);
+    setColour(ComboBox::outlineColourId, theme.ink);
+    setColour(ComboBox::focusedOutlineColourId, theme.ink);
+    setColour(ComboBox::textColourId, theme.ink);
+    setColour(ComboBox::arrowColourId, theme.ink);
+    setColour(ComboBox::backgroundColourId, theme.paper);
+    setColour(ComboBox::buttonColourId, theme.paper);
+    setColour(PopupMenu::backgroundColourId, theme.paper);
+    setColour(PopupMenu::headerTextColourId, theme.ink);
+    setColour(PopupMenu::highlightedBackgroundColourId, selectedBackground);
+    setColour(PopupMenu::highlightedTextColourId, theme.ink);
+    setColour(PopupMenu::textColourId, theme.ink);
+
+    setColour(Slider::thumbColourId, theme.ink);
+    setColour(Slider::trackColourId, theme.ink);
+    setColour(Slider::rotarySliderFillColourId, theme.ink);
+    setColour(Slider::rotarySliderOutlineColourId, theme.ink);
+    setColour(Slider::backgroundColourId, theme.paper);
+}
 
 void CustomLookAndFeel::drawRotarySlider(Graphics& g, int x, int y, int width, int height, float sliderPos,
     const float rotaryStartAngle, const float rotaryEndAngle, Slider& slider)
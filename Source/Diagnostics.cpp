@@ -0,0 +1,287 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "Diagnostics.h"
+
+#if ICOF_DIAGNOSTICS
+#include <numeric>
+#include "PluginProcessor.h"
+
+//==============================================================================
+//Everything on a thread inside an AudioThreadScope counts against it
+static thread_local int audioThreadScopes = 0;
+static std::atomic<int> audioThreadAllocations{ 0 };
+static std::atomic<int> audioThreadFrees{ 0 };
+static std::atomic<int> audioThreadBlockingCalls{ 0 };
+static std::atomic<const char*> lastBlockingCall{ nullptr };
+
+Diagnostics::AudioThreadScope::AudioThreadScope()
+{
+    audioThreadScopes++;
+}
+
+Diagnostics::AudioThreadScope::~AudioThreadScope()
+{
+    audioThreadScopes--;
+}
+
+void Diagnostics::blockingCall(const char* what)
+{
+    if (audioThreadScopes > 0)
+    {
+        audioThreadBlockingCalls++;
+        lastBlockingCall = what;
+    }
+}
+
+void Diagnostics::allocated()
+{
+    if (audioThreadScopes > 0)
+        audioThreadAllocations++;
+}
+
+void Diagnostics::freed()
+{
+    if (audioThreadScopes > 0)
+        audioThreadFrees++;
+}
+
+//Only true where the global operators have been replaced to call the above
+static bool areAllocationsCounted()
+{
+    audioThreadAllocations = 0;
+    {
+        Diagnostics::AudioThreadScope audioThread;
+        //Called directly, a new expression may be optimised away
+        ::operator delete(::operator new(1));
+    }
+    return audioThreadAllocations.exchange(0) > 0;
+}
+
+//==============================================================================
+//High resolution ticks of each stage, 0 until reached
+static juce::int64 latencyStamps[Diagnostics::numLatencyStages] = {};
+static bool latencyProbeArmed = false;
+
+void Diagnostics::armLatencyProbe()
+{
+    std::fill(std::begin(latencyStamps), std::end(latencyStamps), (juce::int64)0);
+    latencyProbeArmed = true;
+}
+
+void Diagnostics::markLatency(LatencyStage stage)
+{
+    if (!latencyProbeArmed || latencyStamps[stage] != 0 || (stage > inputArrived && latencyStamps[stage - 1] == 0))
+        return;
+    latencyStamps[stage] = juce::Time::getHighResolutionTicks();
+    if (stage == framePresented)
+        latencyProbeArmed = false;
+}
+
+bool Diagnostics::getLatencyProbe(double* milliseconds)
+{
+    if (latencyStamps[framePresented] == 0)
+        return false;
+    for (int stage = 0; stage < numLatencyStages; stage++)
+        milliseconds[stage] = juce::Time::highResolutionTicksToSeconds(latencyStamps[stage] - latencyStamps[inputArrived]) * 1000;
+    return true;
+}
+
+juce::String Diagnostics::describeLatencies(std::vector<double>& milliseconds)
+{
+    if (milliseconds.empty())
+        return "none";
+    std::sort(milliseconds.begin(), milliseconds.end());
+    auto percentile = [&milliseconds](double fraction) { return milliseconds[(size_t)((double)(milliseconds.size() - 1) * fraction)]; };
+    juce::String text;
+    text << "median " << juce::String(percentile(0.5), 1) << " ms, 95th percentile " << juce::String(percentile(0.95), 1)
+         << " ms, worst " << juce::String(milliseconds.back(), 1) << " ms";
+    return text;
+}
+
+//Average, 99th percentile and worst of per block times, in microseconds
+static juce::String describeBlockTimes(std::vector<double>& microseconds, double blockMicroseconds)
+{
+    if (microseconds.empty())
+        return "no blocks";
+    std::sort(microseconds.begin(), microseconds.end());
+    double average = std::accumulate(microseconds.begin(), microseconds.end(), 0.0) / (double)microseconds.size();
+    double percentile99 = microseconds[(size_t)((double)(microseconds.size() - 1) * 0.99)];
+    double worst = microseconds.back();
+    juce::String text;
+    text << "average " << juce::String(average, 2) << " us (" << juce::String(average / blockMicroseconds * 100, 2) << "%), "
+         << "99th percentile " << juce::String(percentile99, 2) << " us, "
+         << "worst " << juce::String(worst, 2) << " us (" << juce::String(worst / blockMicroseconds * 100, 2) << "%)";
+    return text;
+}
+
+juce::String Diagnostics::benchmarkAuditionSynth()
+{
+    constexpr double sampleRate = 48000;
+    constexpr int blockSize = 64;
+    constexpr int numBlocks = (int)(sampleRate * 10) / blockSize;
+
+    AuditionSynth synth;
+    synth.setEnabled(true);
+    synth.prepare(sampleRate);
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midi;
+    for (int voice = 0; voice < AuditionSynth::maxVoices; voice++)
+        midi.addEvent(juce::MidiMessage::noteOn(1, 36 + voice, (juce::uint8)100), 0);
+
+    //Ten seconds of every voice held, the first block starts them all
+    std::vector<double> microseconds;
+    microseconds.reserve((size_t)numBlocks);
+    for (int block = 0; block < numBlocks; block++)
+    {
+        buffer.clear();
+        juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+        synth.process(buffer, midi);
+        microseconds.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1e6);
+        midi.clear();
+    }
+
+    juce::String text;
+    text << synth.getNumActiveVoices() << " voices, " << blockSize << " sample blocks at " << (int)sampleRate << " Hz: "
+         << describeBlockTimes(microseconds, blockSize * 1e6 / sampleRate);
+    return text;
+}
+
+//==============================================================================
+//A transport playing from the start at 120 bpm in 4/4, so the chord sequencer runs
+class ScriptedPlayHead : public juce::AudioPlayHead
+{
+public:
+    juce::Optional<PositionInfo> getPosition() const override
+    {
+        PositionInfo position;
+        position.setIsPlaying(true);
+        position.setBpm(120.0);
+        position.setTimeSignature(TimeSignature{ 4, 4 });
+        position.setTimeInSamples(samplePosition);
+        position.setPpqPosition(samplePosition / sampleRate * 2.0);
+        return position;
+    }
+
+    double sampleRate = 44100;
+    juce::int64 samplePosition = 0;
+};
+
+juce::String Diagnostics::checkRealtimeSafety(bool* passed)
+{
+    juce::String report;
+    int numFailures = 0;
+    bool allocationsCounted = areAllocationsCounted();
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0 })
+    {
+        for (int blockSize : { 32, 64, 441, 1024 })
+        {
+            //A fresh processor each time, with everything that runs on the audio thread switched on
+            InteractiveCircleOfFifthsAudioProcessor processor;
+            ScriptedPlayHead playHead;
+            playHead.sampleRate = sampleRate;
+            processor.setPlayHead(&playHead);
+            processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor.setRootNote(2);
+            processor.setModeIndex(1);
+            processor.getAudioAnalyser().setEnabled(true);
+            processor.getChordSequencer().setEnabled(true);
+            processor.getChordSequencer().setProgression(parseProgression("ii V I vi"));
+            processor.getTransitionPlayer().setEnabled(true);
+            processor.getAuditionSynth().setEnabled(true);
+            processor.getScaleQuantiser().setSnap(ScaleQuantiser::nearest);
+            processor.prepareToPlay(sampleRate, blockSize);
+            processor.getTransitionPlayer().play({ { 50, 53, 57, 60 }, 4, { 55, 59, 62, 65 }, 4 });
+            processor.getAuditionSynth().play({ { 62, 64, 65, 67, 69, 71, 72, 74 }, 8, 0.1f, 0.09f });
+
+            juce::AudioBuffer<float> buffer(2, blockSize);
+            juce::MidiBuffer midi;
+            midi.ensureSize(4096);
+            int numBlocks = (int)(sampleRate * 4) / blockSize;
+            int samplesPerChord = (int)(sampleRate / 4);
+            std::vector<double> microseconds;
+            microseconds.reserve((size_t)numBlocks);
+            audioThreadAllocations = 0;
+            audioThreadFrees = 0;
+            audioThreadBlockingCalls = 0;
+            lastBlockingCall = nullptr;
+
+            for (int block = 0; block < numBlocks; block++)
+            {
+                //A D minor seventh chord on the input, and a chord on and off on the MIDI input 4 times a second
+                juce::int64 start = playHead.samplePosition;
+                for (int sample = 0; sample < blockSize; sample++)
+                {
+                    double time = (double)(start + sample) / sampleRate;
+                    float value = 0;
+                    for (double frequency : { 146.83, 174.61, 220.0, 261.63 })
+                        value += 0.1f * (float)std::sin(juce::MathConstants<double>::twoPi * frequency * time);
+                    buffer.setSample(0, sample, value);
+                    buffer.setSample(1, sample, value);
+                }
+                midi.clear();
+                juce::int64 chordStart = (start + samplesPerChord - 1) / samplesPerChord * samplesPerChord;
+                if (chordStart < start + blockSize)
+                {
+                    int offset = (int)(chordStart - start);
+                    int chord = (int)(chordStart / samplesPerChord);
+                    for (int note : { 60, 64, 67 })
+                    {
+                        midi.addEvent(juce::MidiMessage::noteOff(1, note + (chord - 1) % 5), offset);
+                        midi.addEvent(juce::MidiMessage::noteOn(1, note + chord % 5, (juce::uint8)100), offset);
+                    }
+                }
+
+                juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+                {
+                    AudioThreadScope audioThread;
+                    processor.processBlock(buffer, midi);
+                }
+                microseconds.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1e6);
+                playHead.samplePosition += blockSize;
+            }
+            processor.releaseResources();
+            processor.setPlayHead(nullptr);
+
+            bool failed = audioThreadAllocations > 0 || audioThreadFrees > 0 || audioThreadBlockingCalls > 0;
+            numFailures += failed ? 1 : 0;
+            report << (failed ? "FAILED " : "ok ") << (int)sampleRate << " Hz, " << blockSize << " samples: ";
+            if (failed)
+            {
+                report << audioThreadAllocations.load() << " allocations, " << audioThreadFrees.load() << " frees, "
+                       << audioThreadBlockingCalls.load() << " blocking calls";
+                if (const char* what = lastBlockingCall.load())
+                    report << " (" << what << ")";
+                report << ", ";
+            }
+            report << describeBlockTimes(microseconds, blockSize * 1e6 / sampleRate) << "\n";
+        }
+    }
+    if (passed != nullptr)
+        *passed = numFailures == 0;
+    juce::String summary = numFailures == 0 ? juce::String("Passed\n") : juce::String(numFailures) + " configurations failed\n";
+    if (!allocationsCounted)
+        summary << "Allocations are not counted in the plugin, run the RealtimeCheck console app for those\n";
+    return summary + "\n" + report;
+}
+#endif
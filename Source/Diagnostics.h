@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Measurements that need no host, run from the Diagnostics submenu of the
+// options menu. On in debug builds, or in any build with ICOF_DIAGNOSTICS=1.
+#ifndef ICOF_DIAGNOSTICS
+ #define ICOF_DIAGNOSTICS JUCE_DEBUG
+#endif
+
+#if ICOF_DIAGNOSTICS
+namespace Diagnostics
+{
+    // Renders every voice of the audition synth at 64 sample blocks, and
+    // reports the cost per block against the time the block lasts
+    juce::String benchmarkAuditionSynth();
+
+    // Runs the processor offline with every feature on, scripted MIDI and
+    // audio, at a range of sample rates and block sizes. Fails if processBlock
+    // makes a call marked with ICOF_BLOCKING_CALL, or allocates or frees with
+    // operator new and delete. Allocations are only seen in the RealtimeCheck
+    // console app, which replaces the global operators; the plugin never does.
+    // Memory JUCE takes with malloc directly is not seen either, so MIDI
+    // buffers are given room up front the way hosts do.
+    juce::String checkRealtimeSafety(bool* passed = nullptr);
+
+    // Counted when made while a scope is alive on the calling thread
+    struct AudioThreadScope
+    {
+        AudioThreadScope();
+        ~AudioThreadScope();
+    };
+    void blockingCall(const char* what);
+    // Called by the replaced operators in RealtimeCheck/AllocationHooks.cpp
+    void allocated();
+    void freed();
+
+    // The way from an input event to the screen. Each stage is timed the first
+    // time it is marked after the one before it, once the probe is armed.
+    enum LatencyStage { inputArrived, stateChanged, paintStarted, paintEnded, framePresented, numLatencyStages };
+
+    // Message thread
+    void armLatencyProbe();
+    void markLatency(LatencyStage stage);
+    // Milliseconds from the input to each stage, false until the frame was presented
+    bool getLatencyProbe(double* milliseconds /* [numLatencyStages] */);
+
+    // Median, 95th percentile and worst
+    juce::String describeLatencies(std::vector<double>& milliseconds);
+}
+
+ // Marks code that may lock, wait or call the message thread
+ #define ICOF_BLOCKING_CALL(what) Diagnostics::blockingCall (what)
+ #define ICOF_LATENCY_MARK(stage) Diagnostics::markLatency (Diagnostics::stage)
+#else
+ #define ICOF_BLOCKING_CALL(what)
+ #define ICOF_LATENCY_MARK(stage)
+#endif
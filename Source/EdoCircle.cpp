@@ -0,0 +1,288 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "EdoCircle.h"
+#include <numeric>
+
+//Radii of the generated rings, relative to the circle, matching the artwork
+static constexpr float outerRing = 0.996f;
+static constexpr float middleRing = 0.584f;
+static constexpr float innerRing = 0.221f;
+static constexpr float labelRing = (outerRing + middleRing) / 2;
+
+//Chain of fifths positions of the notes of noteNames, C being 0
+static constexpr int noteNameChainPositions[12] { 0, 7, 2, -3, 4, -1, 6, 1, -4, 3, -2, 5 };
+
+//Chain positions, relative to the root, where each diatonic mode starts, in mode menu order
+static constexpr int modeChainStarts[7] { -1, -3, -5, 0, -2, -4, -6 };
+
+static int modulo(int value, int divisor)
+{
+    return ((value % divisor) + divisor) % divisor;
+}
+
+static juce::String chainPositionName(int position)
+{
+    //F C G D A E B, then again with a sharp each time round, or a flat going the other way
+    int letter = modulo(position + 1, 7);
+    int accidentals = (position + 1 - letter) / 7;
+    juce::String name = juce::String::charToString("FCGDAEB"[letter]);
+    return name + juce::String::repeatedString(accidentals > 0 ? "#" : "b", std::abs(accidentals));
+}
+
+EdoCircle::EdoCircle(int newDivisions, int newGenerator)
+{
+    jassert(isValid(newDivisions, newGenerator));
+    divisions = newDivisions;
+    generator = newGenerator;
+
+    steps.resize((size_t)divisions);
+    circleIndices.resize((size_t)divisions);
+    for (int idx = 0; idx < divisions; idx++)
+    {
+        steps[(size_t)idx] = modulo(idx * generator, divisions);
+        circleIndices[(size_t)steps[(size_t)idx]] = idx;
+    }
+
+    stepNames.resize((size_t)divisions);
+    if (divisions == 12)
+    {
+        for (int step = 0; step < 12; step++)
+            stepNames[(size_t)step] = noteNames[step];
+        return;
+    }
+
+    //Names along the chain of generators, nearest to C first, up to double sharps and flats
+    std::vector<int> accidentalCounts((size_t)divisions, 99);
+    for (int distance = 0; distance <= 19; distance++)
+    {
+        for (int position : { distance, -distance })
+        {
+            if (position < -15 || position > 19)
+                continue;
+            int step = modulo(position * generator, divisions);
+            if (stepNames[(size_t)step].isEmpty())
+            {
+                stepNames[(size_t)step] = chainPositionName(position);
+                accidentalCounts[(size_t)step] = std::abs((position + 1 - modulo(position + 1, 7)) / 7);
+            }
+        }
+    }
+    //The rest are ups and downs from the nearest step with at most one accidental
+    for (int step = 0; step < divisions; step++)
+    {
+        if (stepNames[(size_t)step].isNotEmpty())
+            continue;
+        for (int distance = 1; distance < divisions; distance++)
+        {
+            int below = modulo(step - distance, divisions);
+            int above = modulo(step + distance, divisions);
+            if (accidentalCounts[(size_t)below] <= 1)
+            {
+                stepNames[(size_t)step] = stepNames[(size_t)below] + juce::String::repeatedString("^", distance);
+                break;
+            }
+            if (accidentalCounts[(size_t)above] <= 1)
+            {
+                stepNames[(size_t)step] = stepNames[(size_t)above] + juce::String::repeatedString("v", distance);
+                break;
+            }
+        }
+    }
+}
+
+bool EdoCircle::isValid(int divisions, int generator)
+{
+    //The generator has to visit every step before getting back to the start
+    return divisions >= 5 && divisions <= 72 && generator > 0 && generator < divisions
+        && std::gcd(divisions, generator) == 1;
+}
+
+int EdoCircle::fifthGenerator(int divisions)
+{
+    return juce::roundToInt(divisions * std::log2(1.5));
+}
+
+int EdoCircle::stepAt(int circleIndex) const
+{
+    return steps[(size_t)modulo(circleIndex, divisions)];
+}
+
+int EdoCircle::circleIndexOf(int step) const
+{
+    return circleIndices[(size_t)modulo(step, divisions)];
+}
+
+int EdoCircle::circleIndexAt(float degrees) const
+{
+    //Sectors are centred on their note, so the top one starts half a sector to the left
+    return modulo((int)std::floor(degrees / getSectorDegrees() + 0.5f), divisions);
+}
+
+const juce::String& EdoCircle::getStepName(int step) const
+{
+    return stepNames[(size_t)modulo(step, divisions)];
+}
+
+int EdoCircle::stepFromPitchClass(int pc) const
+{
+    if (divisions == 12)
+        return pitchClass(pc);
+    return modulo(noteNameChainPositions[pitchClass(pc)] * generator, divisions);
+}
+
+std::optional<int> EdoCircle::getModeChainStart(int mode) const
+{
+    if (mode >= 0 && mode < 7)
+        return modeChainStarts[mode];
+    return std::nullopt;
+}
+
+EdoCircle::Rendered& EdoCircle::getRendered(int pixelSize, juce::Colour ink)
+{
+    auto key = std::make_pair(pixelSize, ink.getARGB());
+    auto found = renderCache.find(key);
+    if (found != renderCache.end())
+    {
+        found->second.lastUsed = ++useCounter;
+        return found->second;
+    }
+
+    if ((int)renderCache.size() >= maxRendered)
+    {
+        auto oldest = std::min_element(renderCache.begin(), renderCache.end(),
+            [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+        renderCache.erase(oldest);
+    }
+
+    Rendered& rendered = renderCache[key];
+    rendered.lastUsed = ++useCounter;
+
+    float size = (float)pixelSize;
+    float lineThickness = juce::jmax(1.0f, size * 0.004f);
+    juce::Rectangle<float> bounds(size, size);
+    rendered.ring = juce::Image(juce::Image::ARGB, pixelSize, pixelSize, true);
+    {
+        juce::Graphics g(rendered.ring);
+        g.setColour(ink);
+        for (float radius : { outerRing, middleRing, innerRing })
+            g.drawEllipse(bounds.withSizeKeepingCentre(size * radius, size * radius).reduced(lineThickness / 2), lineThickness);
+
+        juce::Point<float> centre = bounds.getCentre();
+        for (int idx = 0; idx < divisions; idx++)
+        {
+            float angle = (idx + 0.5f) * juce::MathConstants<float>::twoPi / divisions;
+            juce::Point<float> direction(std::sin(angle), -std::cos(angle));
+            g.drawLine(juce::Line<float>(centre + direction * (size * middleRing / 2), centre + direction * (size * outerRing / 2)), lineThickness);
+        }
+    }
+
+    //Labels as big as the sector and the band allow, each rendered when first shown
+    float arc = juce::MathConstants<float>::pi * size * labelRing / divisions;
+    rendered.font = juce::Font(juce::jmin(size * (outerRing - middleRing) * 0.2f, arc * 0.6f));
+    return rendered;
+}
+
+size_t EdoCircle::getMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& [key, rendered] : renderCache)
+    {
+        bytes += (size_t)rendered.ring.getWidth() * (size_t)rendered.ring.getHeight() * 4;
+        for (const auto& [name, label] : rendered.labels)
+            bytes += (size_t)label.getWidth() * (size_t)label.getHeight() * 4 + sizeof(label) + (size_t)name.getNumBytesAsUTF8();
+    }
+    return bytes;
+}
+
+void EdoCircle::clearRenders()
+{
+    renderCache.clear();
+}
+
+const juce::Image& EdoCircle::getLabel(Rendered& rendered, const juce::String& name, juce::Colour ink)
+{
+    auto found = rendered.labels.find(name);
+    if (found != rendered.labels.end())
+        return found->second;
+
+    //Every spelling of every key is well under the limit, it only guards against runaway names
+    if ((int)rendered.labels.size() >= maxLabels)
+        rendered.labels.clear();
+    int width = juce::jmax(1, (int)std::ceil(rendered.font.getStringWidthFloat(name)));
+    int height = juce::jmax(1, (int)std::ceil(rendered.font.getHeight()));
+    juce::Image label(juce::Image::ARGB, width, height, true);
+    juce::Graphics g(label);
+    g.setColour(ink);
+    g.setFont(rendered.font);
+    g.drawText(name, 0, 0, width, height, juce::Justification::centred, false);
+    return rendered.labels[name] = label;
+}
+
+void EdoCircle::paint(juce::Graphics& g, juce::Rectangle<float> bounds, int root, int mode, juce::Colour ink, int pixelSize)
+{
+    float sectorRadians = juce::MathConstants<float>::twoPi / divisions;
+    juce::Rectangle<float> outer = bounds.withSizeKeepingCentre(bounds.getWidth() * outerRing, bounds.getHeight() * outerRing);
+
+    //Only the overlay is built per paint, as seven sectors at most
+    std::optional<int> chainStart = getModeChainStart(mode);
+    if (chainStart.has_value())
+    {
+        juce::Path scale;
+        scale.addPieSegment(outer, (*chainStart - 0.5f) * sectorRadians, (*chainStart + 6.5f) * sectorRadians, middleRing / outerRing);
+        g.setColour(ink.withAlpha(0.1f));
+        g.fillPath(scale);
+    }
+    juce::Path rootSector;
+    rootSector.addPieSegment(outer, -0.5f * sectorRadians, 0.5f * sectorRadians, middleRing / outerRing);
+    g.setColour(ink.withAlpha(0.15f));
+    g.fillPath(rootSector);
+
+    paintNotes(g, bounds, root, stepNames.data(), ink, pixelSize);
+
+    g.setColour(ink);
+    g.setFont(bounds.getWidth() * innerRing * 0.3f);
+    juce::String centreText = getStepName(root) + "\n" + juce::String(divisions) + "-EDO";
+    g.drawFittedText(centreText, bounds.withSizeKeepingCentre(bounds.getWidth() * innerRing, bounds.getHeight() * innerRing).toNearestInt(),
+        juce::Justification::centred, 2);
+}
+
+void EdoCircle::paintNotes(juce::Graphics& g, juce::Rectangle<float> bounds, int root, const juce::String* names,
+    juce::Colour ink, int pixelSize)
+{
+    Rendered& rendered = getRendered(pixelSize, ink);
+    g.drawImage(rendered.ring, bounds);
+
+    //Labels stay upright whichever way the circle has turned
+    float sectorRadians = juce::MathConstants<float>::twoPi / divisions;
+    float scale = bounds.getWidth() / pixelSize;
+    juce::Point<float> centre = bounds.getCentre();
+    for (int idx = 0; idx < divisions; idx++)
+    {
+        const juce::Image& label = getLabel(rendered, names[modulo(root + stepAt(idx), divisions)], ink);
+        float angle = idx * sectorRadians;
+        juce::Point<float> position = centre + juce::Point<float>(std::sin(angle), -std::cos(angle)) * (bounds.getWidth() * labelRing / 2);
+        juce::Rectangle<float> area(label.getWidth() * scale, label.getHeight() * scale);
+        g.drawImage(label, area.withCentre(position));
+    }
+}
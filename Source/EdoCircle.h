@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// A circle of generators for any equal division of the octave, e.g. the circle
+// of fifths of 12, 19, 31 or 53-EDO.
+//
+// Steps are notes of the EDO, 0 being C. Circle indices count sectors clockwise
+// from the top, where the root sits. The note circle is generated rather than
+// drawn from artwork: the rings and spokes look the same after every rotation
+// by a whole sector, so one image per size serves every root, and only the
+// label images move. Labels are rendered once per size and name, so spelling
+// them differently for each key costs a lookup.
+class EdoCircle
+{
+public:
+    EdoCircle(int divisions = 12, int generator = 7);
+
+    static bool isValid(int divisions, int generator);
+    // The generator closest to a just fifth
+    static int fifthGenerator(int divisions);
+
+    int getDivisions() const { return divisions; }
+    int getGenerator() const { return generator; }
+    float getSectorDegrees() const { return 360.0f / divisions; }
+
+    // Steps above the root of each sector, and the other way around. Table lookups.
+    int stepAt(int circleIndex) const;
+    int circleIndexOf(int step) const;
+    // The sector under an angle in degrees, clockwise from the top
+    int circleIndexAt(float degrees) const;
+
+    // Ups and downs from the nearest 12-TET note, e.g. "C", "C#^" or "Ebv"
+    const juce::String& getStepName(int step) const;
+    // The step closest to a 12-TET pitch class
+    int stepFromPitchClass(int pitchClass) const;
+
+    // The diatonic modes are seven adjacent sectors, starting this many generators
+    // from the root. Empty for harmonic and melodic minor, which are not a chain
+    // of generators, and when only the notes are shown.
+    std::optional<int> getModeChainStart(int mode) const;
+
+    void paint(juce::Graphics& g, juce::Rectangle<float> bounds, int root, int mode, juce::Colour ink, int pixelSize);
+    // Just the rings, spokes and labels, names being per step, e.g. for the
+    // 12-EDO circle under the mode artwork
+    void paintNotes(juce::Graphics& g, juce::Rectangle<float> bounds, int root, const juce::String* names,
+        juce::Colour ink, int pixelSize);
+
+    // The rings and labels rendered so far, and letting them go to be rendered again when next painted
+    size_t getMemoryBytes() const;
+    void clearRenders();
+
+private:
+    struct Rendered
+    {
+        juce::Image ring;
+        juce::Font font;
+        std::map<juce::String, juce::Image> labels;   // by name
+        juce::int64 lastUsed = 0;
+    };
+    Rendered& getRendered(int pixelSize, juce::Colour ink);
+    static const juce::Image& getLabel(Rendered& rendered, const juce::String& name, juce::Colour ink);
+
+    int divisions;
+    int generator;
+    std::vector<int> steps;
+    std::vector<int> circleIndices;
+    std::vector<juce::String> stepNames;
+
+    std::map<std::pair<int, juce::uint32>, Rendered> renderCache;
+    juce::int64 useCounter = 0;
+    static constexpr int maxRendered = 4;
+    static constexpr int maxLabels = 256;
+};
@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "HeldNotes.h"
+
+//Snapshot layout: bits 0-11 the pitch classes, 12-15 the bass or 15 for none, 16-31 the version
+static constexpr int noBass = 15;
+
+void HeldNotes::process(const juce::MidiBuffer& midi)
+{
+    juce::uint32 versionBefore = version;
+    for (const juce::MidiMessageMetadata metadata : midi)
+    {
+        //Read from the raw bytes, a MidiMessage would allocate for long SysEx
+        if (metadata.numBytes < 3)
+            continue;
+        const juce::uint8* data = metadata.data;
+        int status = data[0] & 0xf0;
+        if (status == 0x90 && data[2] != 0)
+            noteOn(data[1] & 0x7f);
+        else if (status == 0x80 || status == 0x90)
+            noteOff(data[1] & 0x7f);
+        else if (status == 0xb0 && (data[1] == 120 || data[1] == 123))
+            reset();
+    }
+    if (version != versionBefore)
+        publish();
+}
+
+void HeldNotes::reset()
+{
+    std::fill(std::begin(noteCounts), std::end(noteCounts), (juce::uint8)0);
+    std::fill(std::begin(heldNotes), std::end(heldNotes), 0u);
+    std::fill(std::begin(pitchClassCounts), std::end(pitchClassCounts), 0);
+    mask = 0;
+    version++;
+    publish();
+}
+
+void HeldNotes::noteOn(int note)
+{
+    if (noteCounts[note]++ != 0)
+        return;
+    heldNotes[note >> 5] |= 1u << (note & 31);
+    if (pitchClassCounts[pitchClass(note)]++ == 0)
+        mask |= (juce::uint16)(1 << pitchClass(note));
+    version++;
+}
+
+void HeldNotes::noteOff(int note)
+{
+    if (noteCounts[note] == 0 || --noteCounts[note] != 0)
+        return;
+    heldNotes[note >> 5] &= ~(1u << (note & 31));
+    if (--pitchClassCounts[pitchClass(note)] == 0)
+        mask &= (juce::uint16)~(1 << pitchClass(note));
+    version++;
+}
+
+void HeldNotes::publish()
+{
+    int bass = noBass;
+    for (int word = 0; word < 4; word++)
+    {
+        if (heldNotes[word] != 0)
+        {
+            //The lowest set bit on its own, whose position is then the highest set bit
+            int bit = juce::findHighestSetBit(heldNotes[word] & (~heldNotes[word] + 1));
+            bass = pitchClass(word * 32 + bit);
+            break;
+        }
+    }
+    snapshot = (juce::uint32)mask | ((juce::uint32)bass << 12) | (version << 16);
+
+    juce::uint32 sequence = notesSequence.load(std::memory_order_relaxed);
+    notesSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int word = 0; word < 4; word++)
+        publishedNotes[word].store(heldNotes[word], std::memory_order_relaxed);
+    notesSequence.store(sequence + 2, std::memory_order_release);
+}
+
+HeldNotes::Snapshot HeldNotes::getSnapshot() const
+{
+    juce::uint32 packed = snapshot;
+    int bass = (int)((packed >> 12) & 0xf);
+    return { (juce::uint16)(packed & 0xfff), bass == noBass ? -1 : bass, packed >> 16 };
+}
+
+HeldNotes::Notes HeldNotes::getNotes() const
+{
+    Notes notes;
+    for (;;)
+    {
+        juce::uint32 before = notesSequence.load(std::memory_order_acquire);
+        for (int word = 0; word < 4; word++)
+            notes.bits[word] = publishedNotes[word].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((before & 1) == 0 && notesSequence.load(std::memory_order_relaxed) == before)
+            return notes;
+    }
+}
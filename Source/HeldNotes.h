@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// Keeps track of the MIDI notes being held on the input.
+//
+// The audio thread packs the pitch classes, the lowest note and a change count
+// into a single atomic word, so the editor always reads a consistent snapshot
+// without locking or going through the message thread. The notes themselves
+// are published as a 128 bit set behind a sequence count, which readers retry
+// on and the audio thread never waits for.
+class HeldNotes
+{
+public:
+    struct Snapshot
+    {
+        juce::uint16 mask;      // pitch classes held
+        int bass;               // pitch class of the lowest note held, -1 when none
+        juce::uint32 version;   // changes every time the notes do
+    };
+
+    struct Notes
+    {
+        juce::uint32 bits[4];
+
+        bool contains(int note) const { return (bits[note >> 5] >> (note & 31)) & 1; }
+    };
+
+    // Audio thread
+    void process(const juce::MidiBuffer& midi);
+    void reset();
+
+    // Any thread
+    Snapshot getSnapshot() const;
+    Notes getNotes() const;
+
+private:
+    void noteOn(int note);
+    void noteOff(int note);
+    void publish();
+
+    juce::uint8 noteCounts[128] = {};   // the same note can be held on several channels
+    juce::uint32 heldNotes[4] = {};
+    int pitchClassCounts[12] = {};
+    juce::uint16 mask = 0;
+    juce::uint32 version = 0;
+
+    std::atomic<juce::uint32> snapshot{ 0x0000f000 };
+    std::atomic<juce::uint32> notesSequence{ 0 };   // odd while being written
+    std::atomic<juce::uint32> publishedNotes[4] = {};
+};
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "PluginEditor.h"
+
+#if ICOF_DIAGNOSTICS
+LatencyHarness::LatencyHarness(Component& editor, CircleComponent& circle, ComboBox& modeMenu, std::function<void(const String&)> onFinished)
+    : editor(editor), circle(circle), modeMenu(modeMenu), onFinished(onFinished),
+      originalBounds(editor.getBounds()), originalModeId(modeMenu.getSelectedId()), originalRoot(circle.getRootNote())
+{
+    startTimer(5);
+}
+
+void LatencyHarness::timerCallback()
+{
+    if (waiting)
+    {
+        double milliseconds[Diagnostics::numLatencyStages];
+        bool presented = Diagnostics::getLatencyProbe(milliseconds);
+        bool timedOut = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000 > timeoutMs;
+        if (!presented && !timedOut)
+            return;
+
+        waiting = false;
+        if (interaction >= 0)
+        {
+            if (presented)
+            {
+                int kind = interaction % 2;
+                for (int stage = Diagnostics::stateChanged; stage < Diagnostics::numLatencyStages; stage++)
+                    latencies[stage][kind].push_back(milliseconds[stage]);
+                presentedBySize[setting / modeMenu.getNumItems()].push_back(milliseconds[Diagnostics::framePresented]);
+            }
+            else
+                numTimedOut++;
+        }
+        nextInteraction();
+        if (setting == numSizes * modeMenu.getNumItems())
+        {
+            //Leaves the editor as it was found
+            stopTimer();
+            editor.setSize(originalBounds.getWidth(), originalBounds.getHeight());
+            modeMenu.setSelectedId(originalModeId, sendNotificationSync);
+            circle.setRootNote(originalRoot);
+            if (circle.onRootNoteChanged)
+                circle.onRootNoteChanged(originalRoot);
+            onFinished(describe());
+            return;
+        }
+    }
+    startInteraction();
+}
+
+void LatencyHarness::nextInteraction()
+{
+    if (++interaction == interactionsPerSetting)
+    {
+        setting++;
+        interaction = -1;
+    }
+}
+
+void LatencyHarness::startInteraction()
+{
+    if (interaction < 0)
+    {
+        int numModes = modeMenu.getNumItems();
+        int size = setting / numModes;
+        if (setting % numModes == 0)
+            editor.setSize(roundToInt(originalBounds.getWidth() * sizes[size]), roundToInt(originalBounds.getHeight() * sizes[size]));
+        modeMenu.setSelectedId(setting % numModes + 1, sendNotificationSync);
+    }
+
+    //Arrow keys and clicks take turns, each turning the circle
+    Diagnostics::armLatencyProbe();
+    startTicks = Time::getHighResolutionTicks();
+    waiting = true;
+    if (interaction % 2 == 0)
+    {
+        editor.keyPressed(KeyPress(random.nextBool() ? KeyPress::leftKey : KeyPress::rightKey));
+        return;
+    }
+
+    //Anywhere in the notes band but the root at the top, which would leave the circle as it is.
+    //The circle is laid out from its width, see adjustedCircleBounds().
+    float width = (float)circle.getWidth();
+    float angle = random.nextInt({ 1, 12 }) * MathConstants<float>::twoPi / 12;
+    Point<float> position = Point<float>(width / 2, width / 2) + Point<float>(std::sin(angle), -std::cos(angle)) * (width * 0.35f);
+    Time now = Time::getCurrentTime();
+    MouseEvent event(Desktop::getInstance().getMainMouseSource(), position, ModifierKeys(),
+        MouseInputSource::defaultPressure, MouseInputSource::defaultOrientation, MouseInputSource::defaultRotation,
+        MouseInputSource::defaultTiltX, MouseInputSource::defaultTiltY, &circle, &circle, now, position, now, 1, false);
+    circle.mouseDown(event);
+}
+
+String LatencyHarness::describe()
+{
+    const char* kindNames[] { "Arrow keys", "Clicks" };
+    const char* stageNames[] { "", "State changed", "Paint started", "Paint ended", "On screen" };
+    String text;
+    for (int kind = 0; kind < 2; kind++)
+    {
+        text << kindNames[kind] << " (" << (int)latencies[Diagnostics::framePresented][kind].size() << "):\n";
+        for (int stage = Diagnostics::stateChanged; stage < Diagnostics::numLatencyStages; stage++)
+            text << "  " << stageNames[stage] << ": " << Diagnostics::describeLatencies(latencies[stage][kind]) << "\n";
+    }
+    text << "On screen by size:\n";
+    for (int size = 0; size < numSizes; size++)
+        text << "  " << roundToInt(sizes[size] * 100) << "%: " << Diagnostics::describeLatencies(presentedBySize[size]) << "\n";
+    if (numTimedOut > 0)
+        text << numTimedOut << " never reached the screen within " << (int)timeoutMs << " ms\n";
+    return text;
+}
+#endif
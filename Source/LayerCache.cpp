@@ -0,0 +1,364 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "PluginEditor.h"
+
+//"ICOF" as written by writeInt
+static constexpr int diskCacheMagic = 0x464f4349;
+
+LayerDiskCache::LayerDiskCache()
+{
+    map();
+}
+
+LayerDiskCache::~LayerDiskCache()
+{
+    //A write cut short leaves the previous file in place
+    writer.removeAllJobs(true, -1);
+}
+
+File LayerDiskCache::getFile()
+{
+    return File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("InteractiveCircleOfFifths")
+        .getChildFile("LayerCache.bin");
+}
+
+void LayerDiskCache::map()
+{
+    //Only the index is read here, pixels are copied out of the mapping when first drawn
+    const ScopedLock sl(lock);
+    mappedFile.reset();
+    entries.clear();
+    File file = getFile();
+    if (!file.existsAsFile())
+        return;
+    mappedFile = std::make_unique<MemoryMappedFile>(file, MemoryMappedFile::readOnly);
+    if (mappedFile->getData() == nullptr)
+    {
+        mappedFile.reset();
+        return;
+    }
+
+    int64 fileSize = (int64)mappedFile->getSize();
+    MemoryInputStream in(mappedFile->getData(), mappedFile->getSize(), false);
+    if (in.readInt() != diskCacheMagic || in.readInt() != formatVersion)
+    {
+        mappedFile.reset();
+        return;
+    }
+    int numEntries = in.readInt();
+    for (int idx = 0; idx < numEntries && !in.isExhausted(); idx++)
+    {
+        int keyBytes = in.readInt();
+        if (keyBytes <= 0 || keyBytes > in.getNumBytesRemaining())
+            break;
+        String asset = String::fromUTF8(static_cast<const char*>(mappedFile->getData()) + in.getPosition(), keyBytes);
+        in.skipNextBytes(keyBytes);
+        Entry entry;
+        entry.size = in.readInt();
+        entry.offset = in.readInt64();
+        //A truncated file only loses the images past its end
+        if (entry.size > 0 && entry.offset >= 0 && entry.offset + (int64)entry.size * entry.size * 4 <= fileSize)
+            entries[asset] = entry;
+    }
+}
+
+bool LayerDiskCache::contains(const String& asset) const
+{
+    const ScopedLock sl(lock);
+    return entries.find(asset) != entries.end();
+}
+
+Image LayerDiskCache::load(const String& asset, int size) const
+{
+    const ScopedLock sl(lock);
+    auto it = entries.find(asset);
+    if (it == entries.end() || it->second.size != size)
+        return {};
+
+    Image image(Image::ARGB, size, size, false);
+    {
+        Image::BitmapData pixels(image, Image::BitmapData::writeOnly);
+        const uint8* source = static_cast<const uint8*>(mappedFile->getData()) + it->second.offset;
+        for (int y = 0; y < size; y++)
+            memcpy(pixels.getLinePointer(y), source + (size_t)y * (size_t)size * 4, (size_t)size * 4);
+    }
+    return image;
+}
+
+void LayerDiskCache::save(std::vector<std::pair<String, Image>> images)
+{
+    if (writer.getNumJobs() > 0)
+        return;
+
+    int64 totalBytes = 0;
+    bool anyMissing = false;
+    {
+        const ScopedLock sl(lock);
+        for (auto it = images.begin(); it != images.end();)
+        {
+            int64 bytes = (int64)it->second.getWidth() * it->second.getHeight() * 4;
+            if (totalBytes + bytes > maxBytes)
+            {
+                it = images.erase(it);
+                continue;
+            }
+            totalBytes += bytes;
+            auto saved = entries.find(it->first);
+            anyMissing |= saved == entries.end() || saved->second.size != it->second.getWidth();
+            ++it;
+        }
+    }
+    //Another editor, or the last launch, may have saved these already
+    if (!anyMissing)
+        return;
+
+    //The images are shared, not copied, nothing draws into a full quality render once it is cached
+    writer.addJob([this, images = std::move(images)] { write(images); });
+}
+
+void LayerDiskCache::write(const std::vector<std::pair<String, Image>>& images)
+{
+    File file = getFile();
+    file.getParentDirectory().createDirectory();
+    TemporaryFile temporary(file);
+    {
+        FileOutputStream out(temporary.getFile());
+        if (!out.openedOk())
+            return;
+
+        //The index comes first, then each image as rows of premultiplied ARGB
+        out.writeInt(diskCacheMagic);
+        out.writeInt(formatVersion);
+        out.writeInt((int)images.size());
+        int64 offset = 12;
+        for (auto& [asset, image] : images)
+            offset += 4 + (int64)asset.getNumBytesAsUTF8() + 4 + 8;
+        for (auto& [asset, image] : images)
+        {
+            out.writeInt((int)asset.getNumBytesAsUTF8());
+            out.write(asset.toRawUTF8(), asset.getNumBytesAsUTF8());
+            out.writeInt(image.getWidth());
+            out.writeInt64(offset);
+            offset += (int64)image.getWidth() * image.getHeight() * 4;
+        }
+        for (auto& [asset, image] : images)
+        {
+            if (ThreadPoolJob::getCurrentThreadPoolJob()->shouldExit())
+                return;
+            Image::BitmapData pixels(image, Image::BitmapData::readOnly);
+            for (int y = 0; y < pixels.height; y++)
+                out.write(pixels.getLinePointer(y), (size_t)pixels.width * 4);
+        }
+        out.flush();
+        if (out.getStatus().failed())
+            return;
+    }
+
+    //A mapped file cannot be replaced on every platform, so the mapping is let go for the swap
+    {
+        const ScopedLock sl(lock);
+        mappedFile.reset();
+        entries.clear();
+        if (!temporary.overwriteTargetFileWithTemporary())
+            DBG("Could not save " << file.getFullPathName());
+    }
+    map();
+}
+
+size_t LayerDiskCache::getMappedBytes() const
+{
+    const ScopedLock sl(lock);
+    return mappedFile != nullptr ? mappedFile->getSize() : 0;
+}
+
+Image LayerCache::getLayer(const String& asset, int size, const std::function<Drawable*()>& getDrawable)
+{
+    lastSize = size;
+    auto it = entries.find(asset);
+    if (it != entries.end() && it->second.levels.front().getWidth() == size)
+    {
+        it->second.lastUsed = ++useCounter;
+        return visibleLevels(it->second).front();
+    }
+
+    //Saved by the last editor at this size, or rendered from the vectors
+    Image full = diskCache->load(asset, size);
+    if (!full.isValid())
+    {
+        Drawable* drawable = getDrawable();
+        if (drawable == nullptr)
+            return {};
+        full = render(drawable, size);
+        lastRenderMs = Time::getMillisecondCounter();
+        unsaved = true;
+    }
+
+    //A full quality render replaces whatever chain was kept for this layer
+    Entry entry;
+    entry.levels.push_back(full);
+    for (int levelSize = size / 2; levelSize >= smallestLevel; levelSize /= 2)
+        entry.levels.push_back(entry.levels.back().rescaled(levelSize, levelSize, Graphics::mediumResamplingQuality));
+    entry.lastUsed = ++useCounter;
+
+    if (it != entries.end())
+        it->second = std::move(entry);
+    else
+        it = entries.emplace(asset, std::move(entry)).first;
+    const std::vector<Image>& levels = visibleLevels(it->second);
+    evictToBudget();
+    return levels.front();
+}
+
+Image LayerCache::getNearestLayer(const String& asset, int size)
+{
+    auto it = entries.find(asset);
+    if (it == entries.end())
+        return {};
+
+    //Smallest level that is still at least as big as requested, otherwise the largest one
+    it->second.lastUsed = ++useCounter;
+    const std::vector<Image>& levels = visibleLevels(it->second);
+    for (auto level = levels.rbegin(); level != levels.rend(); ++level)
+    {
+        if (level->getWidth() >= size)
+            return *level;
+    }
+    return levels.front();
+}
+
+bool LayerCache::isOnDisk(const String& asset) const
+{
+    return diskCache->contains(asset);
+}
+
+void LayerCache::saveToDiskWhenIdle()
+{
+    //Not while resizing or prewarming, every size passed through would be written
+    if (!unsaved || Time::getMillisecondCounter() - lastRenderMs < saveAfterIdleMs)
+        return;
+    unsaved = false;
+
+    //Only the renders at the size last drawn, which is the size the next launch opens at
+    std::vector<std::pair<String, Image>> images;
+    for (auto& [asset, entry] : entries)
+    {
+        if (entry.levels.front().getWidth() == lastSize)
+            images.emplace_back(asset, entry.levels.front());
+    }
+    diskCache->save(std::move(images));
+}
+
+void LayerCache::setTheme(const Theme* newTheme)
+{
+    //Themed copies are made lazily from the cached light mode rasters, nothing is re-rendered
+    if (newTheme != nullptr)
+        theme = *newTheme;
+    else
+        theme.reset();
+    themeVersion++;
+}
+
+const std::vector<Image>& LayerCache::visibleLevels(Entry& entry)
+{
+    if (!theme.has_value())
+    {
+        entry.themedLevels.clear();
+        return entry.levels;
+    }
+
+    if (entry.themeVersion != themeVersion)
+    {
+        entry.themedLevels.clear();
+        for (const Image& level : entry.levels)
+        {
+            Image themed = level.createCopy();
+            applyTheme(themed, *theme);
+            entry.themedLevels.push_back(themed);
+        }
+        entry.themeVersion = themeVersion;
+        evictToBudget();
+    }
+    return entry.themedLevels;
+}
+
+void LayerCache::clear()
+{
+    entries.clear();
+}
+
+size_t LayerCache::getBytes(const Entry& entry)
+{
+    size_t bytes = 0;
+    for (const std::vector<Image>* levels : { &entry.levels, &entry.themedLevels })
+    {
+        for (const Image& level : *levels)
+            bytes += (size_t)level.getWidth() * (size_t)level.getHeight() * 4;
+    }
+    return bytes;
+}
+
+size_t LayerCache::getMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& [asset, entry] : entries)
+        bytes += getBytes(entry);
+    return bytes;
+}
+
+void LayerCache::releaseAllBut(int numKept)
+{
+    //The most recently drawn are the ones on screen
+    std::vector<std::pair<int64, String>> byUse;
+    for (const auto& [asset, entry] : entries)
+        byUse.emplace_back(entry.lastUsed, asset);
+    std::sort(byUse.begin(), byUse.end(), std::greater<>());
+    for (size_t idx = (size_t)jmax(0, numKept); idx < byUse.size(); idx++)
+        entries.erase(byUse[idx].second);
+}
+
+Image LayerCache::render(Drawable* drawable, int size)
+{
+    Image image(Image::ARGB, size, size, true);
+    Graphics g(image);
+    drawable->drawWithin(g, Rectangle<float>((float)size, (float)size), RectanglePlacement::centred, 1.0);
+    return image;
+}
+
+void LayerCache::evictToBudget()
+{
+    //The most recently drawn layer stays even if it alone is over the budget
+    size_t bytes = getMemoryBytes();
+    while (bytes > maxBytes && entries.size() > 1)
+    {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->second.lastUsed < oldest->second.lastUsed)
+                oldest = it;
+        }
+        bytes -= getBytes(oldest->second);
+        entries.erase(oldest);
+    }
+}
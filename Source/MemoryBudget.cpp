@@ -0,0 +1,163 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "PluginEditor.h"
+
+MemoryBudget::MemoryBudget()
+{
+    std::unique_ptr<XmlElement> xml = XmlDocument::parse(RenderGovernor::getSettingsFile());
+    if (xml != nullptr && xml->hasTagName("SETTINGS"))
+        budgetBytes = (size_t)jmax(0, xml->getIntAttribute("memoryBudgetMb")) * 1024 * 1024;
+}
+
+void MemoryBudget::addEditor(InteractiveCircleOfFifthsAudioProcessorEditor* editor)
+{
+    editors.addIfNotAlreadyThere(editor);
+}
+
+void MemoryBudget::removeEditor(InteractiveCircleOfFifthsAudioProcessorEditor* editor)
+{
+    editors.removeFirstMatchingValue(editor);
+}
+
+void MemoryBudget::setBudgetBytes(size_t newBudgetBytes)
+{
+    budgetBytes = newBudgetBytes;
+    underPressure = false;
+    lastUpdateMs = 0;
+
+    //Other settings may be added by hand, so only this attribute is touched
+    File file = RenderGovernor::getSettingsFile();
+    std::unique_ptr<XmlElement> xml = XmlDocument::parse(file);
+    if (xml == nullptr || !xml->hasTagName("SETTINGS"))
+        xml = std::make_unique<XmlElement>("SETTINGS");
+    xml->setAttribute("memoryBudgetMb", (int)(budgetBytes / (1024 * 1024)));
+    file.getParentDirectory().createDirectory();
+    xml->writeTo(file);
+}
+
+size_t MemoryBudget::getTotalBytes() const
+{
+    //Mapped files and the binary's own resources are paged in and out by the system, so they are not counted
+    int numProcessors = 0;
+    size_t bytes = InteractiveCircleOfFifthsAudioProcessor::getTotalMemoryBytes(numProcessors);
+    for (const InteractiveCircleOfFifthsAudioProcessorEditor* editor : editors)
+    {
+        Usage usage = editor->getMemoryUsage();
+        bytes += usage.layers + usage.noteCircles;
+    }
+    SharedResourcePointer<SVGManager> svgManager;
+    return bytes + svgManager->getMemoryBytes() + svgManager->getSkinPackBytes() + MidiFileAnalyser::getCacheBytes();
+}
+
+void MemoryBudget::update()
+{
+    uint32 now = Time::getMillisecondCounter();
+    if (lastUpdateMs != 0 && now - lastUpdateMs < updateIntervalMs)
+        return;
+    lastUpdateMs = now;
+
+    size_t total = getTotalBytes();
+    for (int what = 0; what < numReleases && budgetBytes > 0 && total > budgetBytes; what++)
+    {
+        DBG("Memory at " << formatBytes(total) << " of " << formatBytes(budgetBytes) << ", releasing caches (" << what << ")");
+        release((Release)what);
+        underPressure = true;
+        total = getTotalBytes();
+    }
+
+    summary = formatBytes(total);
+    if (budgetBytes > 0)
+        summary << " of " << formatBytes(budgetBytes);
+    summary << " in " << editors.size() << (editors.size() == 1 ? " editor" : " editors");
+}
+
+void MemoryBudget::release(Release what)
+{
+    if (what == timelines)
+        MidiFileAnalyser::clearCache();
+    else if (what == artwork)
+        SharedResourcePointer<SVGManager>()->releaseDrawables();
+    else
+    {
+        for (InteractiveCircleOfFifthsAudioProcessorEditor* editor : editors)
+            editor->releaseMemory(what);
+    }
+}
+
+String MemoryBudget::getReport(const InteractiveCircleOfFifthsAudioProcessorEditor& editor) const
+{
+    Usage usage = editor.getMemoryUsage();
+    String report;
+    report << "This editor\n"
+        << "  Layer rasters: " << formatBytes(usage.layers) << "\n"
+        << "  Note circles: " << formatBytes(usage.noteCircles) << "\n"
+        << "  Processor: " << formatBytes(usage.processor) << "\n\n";
+
+    Usage all;
+    for (const InteractiveCircleOfFifthsAudioProcessorEditor* other : editors)
+    {
+        Usage otherUsage = other->getMemoryUsage();
+        all.layers += otherUsage.layers;
+        all.noteCircles += otherUsage.noteCircles;
+    }
+    int numProcessors = 0;
+    all.processor = InteractiveCircleOfFifthsAudioProcessor::getTotalMemoryBytes(numProcessors);
+    report << "All " << editors.size() << " editors and " << numProcessors << " processors\n"
+        << "  Layer rasters: " << formatBytes(all.layers) << "\n"
+        << "  Note circles: " << formatBytes(all.noteCircles) << "\n"
+        << "  Processors: " << formatBytes(all.processor) << "\n\n";
+
+    //Parsed once per process, whatever the number of instances
+    SharedResourcePointer<SVGManager> svgManager;
+    StringArray perAsset;
+    size_t drawableBytes = svgManager->getMemoryBytes(&perAsset);
+    size_t resourceBytes = 0;
+    for (int idx = 0; idx < BinaryData::namedResourceListSize; idx++)
+    {
+        int size = 0;
+        BinaryData::getNamedResource(BinaryData::namedResourceList[idx], size);
+        resourceBytes += (size_t)size;
+    }
+    report << "Shared by the process\n"
+        << "  Parsed artwork: " << formatBytes(drawableBytes) << " in " << perAsset.size() << " assets\n";
+    for (const String& line : perAsset)
+        report << "    " << line << "\n";
+    SharedResourcePointer<LayerDiskCache> diskCache;
+    report << "  MIDI file timelines: " << formatBytes(MidiFileAnalyser::getCacheBytes()) << "\n"
+        << "  Layer file, mapped: " << formatBytes(diskCache->getMappedBytes()) << "\n"
+        << "  Skin packs: " << formatBytes(svgManager->getSkinPackBytes()) << "\n"
+        << "  Embedded resources: " << formatBytes(resourceBytes) << "\n\n";
+
+    report << "Total, not counting mapped files and resources: " << formatBytes(getTotalBytes())
+        << ", budget: " << (budgetBytes > 0 ? formatBytes(budgetBytes) : String("none"));
+    return report;
+}
+
+String MemoryBudget::formatBytes(size_t bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return String(bytes / (1024.0 * 1024.0), 1) + " MB";
+    return String(roundToInt(bytes / 1024.0)) + " KB";
+}
@@ -0,0 +1,225 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "MidiFileAnalyser.h"
+#include "Diagnostics.h"
+
+//Shared by every editor, keyed by path, modification time and size
+static std::map<juce::String, std::shared_ptr<const KeyTimeline>> timelineCache;
+static juce::CriticalSection timelineCacheLock;
+
+const KeyTimeline::Segment* KeyTimeline::getSegmentAt(double time) const
+{
+    auto it = std::upper_bound(segments.begin(), segments.end(), time,
+        [](double t, const Segment& segment) { return t < segment.start; });
+    if (it == segments.begin())
+        return nullptr;
+    return &*(it - 1);
+}
+
+MidiFileAnalyser::MidiFileAnalyser() : workers(juce::jmax(1, juce::SystemStats::getNumCpus()))
+{
+}
+
+MidiFileAnalyser::~MidiFileAnalyser()
+{
+    //Jobs use the analyser, so a running one is waited for however long it takes
+    coordinator.removeAllJobs(true, -1);
+}
+
+bool MidiFileAnalyser::isMidiFile(const juce::String& path)
+{
+    return path.endsWithIgnoreCase(".mid") || path.endsWithIgnoreCase(".midi") || path.endsWithIgnoreCase(".smf");
+}
+
+size_t MidiFileAnalyser::getCacheBytes()
+{
+    const juce::ScopedLock lock(timelineCacheLock);
+    size_t bytes = 0;
+    for (const auto& [key, timeline] : timelineCache)
+        bytes += sizeof(KeyTimeline) + sizeof(KeyTimeline::Segment) * timeline->segments.capacity() + (size_t)key.getNumBytesAsUTF8();
+    return bytes;
+}
+
+void MidiFileAnalyser::clearCache()
+{
+    //Timelines still shown are owned by their components as well
+    const juce::ScopedLock lock(timelineCacheLock);
+    timelineCache.clear();
+}
+
+void MidiFileAnalyser::analyseAsync(const juce::File& file, std::function<void(std::shared_ptr<const KeyTimeline>)> onDone)
+{
+    ICOF_BLOCKING_CALL("MidiFileAnalyser::analyseAsync");
+    coordinator.addJob([this, file, onDone]
+    {
+        std::shared_ptr<const KeyTimeline> timeline = analyse(file);
+        juce::MessageManager::callAsync([onDone, timeline] { onDone(timeline); });
+    });
+}
+
+void MidiFileAnalyser::runInParallel(int numTasks, std::function<void(int)> task)
+{
+    ICOF_BLOCKING_CALL("MidiFileAnalyser::runInParallel");
+    juce::WaitableEvent done;
+    std::atomic<int> remaining{ numTasks };
+    for (int idx = 0; idx < numTasks; idx++)
+    {
+        workers.addJob([&, idx]
+        {
+            task(idx);
+            if (--remaining == 0)
+                done.signal();
+        });
+    }
+    done.wait();
+}
+
+std::shared_ptr<const KeyTimeline> MidiFileAnalyser::analyse(const juce::File& file)
+{
+    juce::String cacheKey = file.getFullPathName() + "|" + juce::String(file.getLastModificationTime().toMilliseconds())
+        + "|" + juce::String(file.getSize());
+    {
+        const juce::ScopedLock lock(timelineCacheLock);
+        auto cached = timelineCache.find(cacheKey);
+        if (cached != timelineCache.end())
+            return cached->second;
+    }
+
+    juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+    juce::MidiFile midiFile;
+    juce::FileInputStream stream(file);
+    if (!stream.openedOk() || !midiFile.readFrom(stream))
+        return nullptr;
+    midiFile.convertTimestampTicksToSeconds();
+
+    auto timeline = std::make_shared<KeyTimeline>();
+    timeline->fileName = file.getFileName();
+    timeline->length = midiFile.getLastTimestamp();
+    int numCells = (int)std::ceil(timeline->length / cellSeconds) + 1;
+    int numTracks = midiFile.getNumTracks();
+
+    //Note durations per cell and pitch class, one grid per task so nothing is shared while adding up
+    int numTrackTasks = juce::jlimit(1, workers.getNumThreads(), numTracks);
+    std::vector<std::vector<float>> partialCells((size_t)numTrackTasks, std::vector<float>((size_t)numCells * 12));
+    runInParallel(numTrackTasks, [&](int task)
+    {
+        std::vector<float>& cells = partialCells[(size_t)task];
+        for (int trackIndex = task; trackIndex < numTracks; trackIndex += numTrackTasks)
+        {
+            for (const juce::MidiMessageSequence::MidiEventHolder* event : *midiFile.getTrack(trackIndex))
+            {
+                const juce::MidiMessage& message = event->message;
+                if (!message.isNoteOn() || message.getChannel() == 10) // drums have no pitch
+                    continue;
+
+                double start = message.getTimeStamp();
+                double end = event->noteOffObject != nullptr ? event->noteOffObject->message.getTimeStamp() : start + 0.5;
+                int pc = pitchClass(message.getNoteNumber());
+                int lastCell = juce::jmin(numCells - 1, (int)(end / cellSeconds));
+                for (int cell = (int)(start / cellSeconds); cell <= lastCell; cell++)
+                {
+                    double overlap = juce::jmin(end, (cell + 1) * cellSeconds) - juce::jmax(start, cell * cellSeconds);
+                    if (overlap > 0)
+                        cells[(size_t)(cell * 12 + pc)] += (float)overlap;
+                }
+            }
+        }
+    });
+
+    //Prefix sums make every window, however long, a single subtraction
+    std::vector<double> prefix((size_t)(numCells + 1) * 12, 0.0);
+    for (int cell = 0; cell < numCells; cell++)
+    {
+        for (int pc = 0; pc < 12; pc++)
+        {
+            double sum = prefix[(size_t)(cell * 12 + pc)];
+            for (const std::vector<float>& cells : partialCells)
+                sum += cells[(size_t)(cell * 12 + pc)];
+            prefix[(size_t)((cell + 1) * 12 + pc)] = sum;
+        }
+    }
+
+    int numWindows = juce::jmax(1, (numCells + cellsPerHop - 1) / cellsPerHop);
+    std::vector<int> windowRoots((size_t)numWindows), windowModes((size_t)numWindows);
+    int numWindowTasks = juce::jlimit(1, workers.getNumThreads() * 4, numWindows / 64 + 1);
+    runInParallel(numWindowTasks, [&](int task)
+    {
+        for (int window = task; window < numWindows; window += numWindowTasks)
+        {
+            //Windows are centred on the hop they describe
+            int centre = window * cellsPerHop + cellsPerHop / 2;
+            int first = juce::jlimit(0, numCells, centre - cellsPerWindow / 2);
+            int last = juce::jlimit(0, numCells, centre + cellsPerWindow / 2);
+
+            float chroma[12];
+            float total = 0;
+            for (int pc = 0; pc < 12; pc++)
+            {
+                chroma[pc] = (float)(prefix[(size_t)(last * 12 + pc)] - prefix[(size_t)(first * 12 + pc)]);
+                total += chroma[pc];
+            }
+            int root = -1, mode = -1;
+            if (total > 0.01f)
+            {
+                for (float& value : chroma)
+                    value /= total;
+                findBestScale(chroma, root, mode);
+            }
+            windowRoots[(size_t)window] = root;
+            windowModes[(size_t)window] = mode;
+        }
+    });
+
+    //Merge equal neighbours, and fold changes shorter than two hops into what came before
+    double hopSeconds = cellsPerHop * cellSeconds;
+    for (int window = 0; window < numWindows; window++)
+    {
+        double start = window * hopSeconds;
+        double end = juce::jmin(timeline->length, start + hopSeconds);
+        int root = windowRoots[(size_t)window];
+        int mode = windowModes[(size_t)window];
+        auto& segments = timeline->segments;
+        if (!segments.empty() && segments.back().root == root && segments.back().mode == mode)
+            segments.back().end = end;
+        else
+            segments.push_back({ start, end, root, mode });
+    }
+    std::vector<KeyTimeline::Segment> smoothed;
+    for (const KeyTimeline::Segment& segment : timeline->segments)
+    {
+        bool isShort = segment.end - segment.start < hopSeconds * 2;
+        if (!smoothed.empty() && (isShort || (smoothed.back().root == segment.root && smoothed.back().mode == segment.mode)))
+            smoothed.back().end = segment.end;
+        else
+            smoothed.push_back(segment);
+    }
+    timeline->segments = std::move(smoothed);
+
+    timeline->analysisSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    DBG("Analysed " << timeline->fileName << " in " << timeline->analysisSeconds * 1000 << " ms");
+
+    const juce::ScopedLock lock(timelineCacheLock);
+    timelineCache[cacheKey] = timeline;
+    return timeline;
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// The keys and modes of a Standard MIDI File over time.
+struct KeyTimeline
+{
+    struct Segment
+    {
+        double start;
+        double end;
+        int root;   // -1 where nothing is playing
+        int mode;
+    };
+
+    std::vector<Segment> segments;
+    double length = 0;
+    double analysisSeconds = 0;
+    juce::String fileName;
+
+    const Segment* getSegmentAt(double time) const;
+};
+
+//==============================================================================
+// Works out a KeyTimeline from sliding pitch class windows over a MIDI file.
+//
+// Note durations are first spread over a grid of short cells, split across the
+// cores by track, so that each window is a difference of two prefix sums. The
+// windows are then scored in parallel as well. Results are cached per file.
+//
+// Files are only dropped now and then, so there is one per process, held
+// through a SharedResourcePointer, rather than a pool of threads per editor.
+class MidiFileAnalyser
+{
+public:
+    MidiFileAnalyser();
+    ~MidiFileAnalyser();
+
+    // Calls back on the message thread, with nullptr if the file could not be read
+    void analyseAsync(const juce::File& file, std::function<void(std::shared_ptr<const KeyTimeline>)> onDone);
+
+    static bool isMidiFile(const juce::String& path);
+
+    // The timelines kept for every file analysed in this process, which are analysed again if dropped
+    static size_t getCacheBytes();
+    static void clearCache();
+
+private:
+    std::shared_ptr<const KeyTimeline> analyse(const juce::File& file);
+    void runInParallel(int numTasks, std::function<void(int)> task);
+
+    // The coordinator waits on the workers, so they need to be separate pools.
+    // Declared in this order so that the coordinator is stopped first.
+    juce::ThreadPool workers;
+    juce::ThreadPool coordinator{ 1 };
+    static constexpr double cellSeconds = 0.25;
+    static constexpr int cellsPerWindow = 16;   // 4 second windows
+    static constexpr int cellsPerHop = 4;       // every second
+};
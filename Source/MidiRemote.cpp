@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "MidiRemote.h"
+
+MidiRemote::MidiRemote()
+{
+    for (auto& binding : bindings)
+        binding = unbound;
+}
+
+void MidiRemote::learn(Action action)
+{
+    learning = action;
+}
+
+bool MidiRemote::isLearning(Action action) const
+{
+    return learning == action;
+}
+
+void MidiRemote::forget(Action action)
+{
+    bindings[action] = unbound;
+    if (learning == action)
+        learning = -1;
+}
+
+int MidiRemote::getBinding(Action action) const
+{
+    return bindings[action];
+}
+
+void MidiRemote::setBinding(Action action, int binding)
+{
+    bindings[action] = juce::jlimit(unbound, programChange, binding);
+}
+
+juce::String MidiRemote::describeBinding(int binding)
+{
+    if (binding == programChange)
+        return "program change";
+    return binding == unbound ? juce::String("not set") : "CC " + juce::String(binding);
+}
+
+void MidiRemote::setListening(bool shouldListen)
+{
+    listening = shouldListen;
+}
+
+bool MidiRemote::pop(Event& event)
+{
+    return queue.pop(event);
+}
+
+bool MidiRemote::usesProgramChanges() const
+{
+    for (const auto& binding : bindings)
+    {
+        if (binding == programChange)
+            return true;
+    }
+    return learning >= 0;
+}
+
+void MidiRemote::process(const juce::MidiBuffer& midi)
+{
+    int values[numActions] = {};
+    bool changed[numActions] = {};
+    int presses = 0;
+    for (const juce::MidiMessageMetadata metadata : midi)
+    {
+        const juce::uint8* data = metadata.data;
+        int status = data[0] & 0xf0;
+        int control;
+        if (status == 0xb0 && metadata.numBytes >= 3)
+            control = data[1];
+        else if (status == 0xc0 && metadata.numBytes >= 2)
+            control = programChange;
+        else
+            continue;
+
+        //The message that is learned does not act as well
+        if (learning >= 0)
+        {
+            int learnAction = learning.exchange(-1);
+            if (learnAction >= 0)
+            {
+                bindings[learnAction] = control;
+                continue;
+            }
+        }
+
+        //Program changes carry the value in the first data byte
+        int value = control == programChange ? data[1] : data[2];
+        for (int action = 0; action < numActions; action++)
+        {
+            if (bindings[action] != control)
+                continue;
+            switch (action)
+            {
+            case turn:
+                values[action] = control == programChange ? value % 12 : value * 12 / 128;
+                changed[action] = true;
+                break;
+            case setMode:
+                values[action] = (control == programChange ? value % (numModes + 1) : value * (numModes + 1) / 128) - 1;
+                changed[action] = true;
+                break;
+            case cycleChords:
+                if (control == programChange)
+                    presses++;
+                else
+                {
+                    bool held = value >= 64;
+                    if (held && !controlHeld)
+                        presses++;
+                    controlHeld = held;
+                }
+                break;
+            }
+        }
+    }
+
+    if (!listening)
+        return;
+    //Only what the block ended on, however many messages it had
+    for (int action = 0; action < numActions; action++)
+    {
+        if (changed[action])
+            queue.push({ (Action)action, values[action] });
+    }
+    if (presses > 0)
+        queue.push({ cycleChords, presses });
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+#include "MusicTheory.h"
+
+//==============================================================================
+// Turns the circle, sets the mode and cycles the chord layer from a hardware
+// controller, with each action learned from the next CC or program change.
+//
+// The audio thread reads the bindings from atomics, keeps only the latest value
+// of each action per block and sends those to the editor through a
+// LockFreeQueue, so a controller swept at full rate costs the message thread
+// at most a few events per block, which the editor folds into one per frame.
+class MidiRemote
+{
+public:
+    enum Action { turn, setMode, cycleChords, numActions };
+
+    struct Event
+    {
+        Action action;
+        int value;  // the circle position from C, the mode (-1 for notes), or how many presses
+    };
+
+    static constexpr int unbound = -1;
+    static constexpr int programChange = 128;   // CCs are bound by their number
+
+    MidiRemote();
+
+    // Message thread
+    void learn(Action action);  // binds the next CC or program change to arrive
+    bool isLearning(Action action) const;
+    void forget(Action action);
+    int getBinding(Action action) const;
+    void setBinding(Action action, int binding);
+    static juce::String describeBinding(int binding);
+
+    // Editor. Events are only queued while it listens, so none are left over for the next one.
+    void setListening(bool shouldListen);
+    bool pop(Event& event);
+
+    // Audio thread
+    void process(const juce::MidiBuffer& midi);
+    bool usesProgramChanges() const;
+
+private:
+    std::atomic<int> bindings[numActions];
+    std::atomic<int> learning{ -1 };
+    std::atomic<bool> listening{ false };
+    LockFreeQueue<Event, 64> queue;
+    bool controlHeld = false;   // a CC bound to cycleChords is a button, pressed above 63
+};
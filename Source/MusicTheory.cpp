@@ -0,0 +1,319 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "MusicTheory.h"
+
+static const juce::StringArray romanNumerals { "I", "II", "III", "IV", "V", "VI", "VII" };
+
+bool findBestScale(const float* chroma, int& root, int& mode)
+{
+    //Relative modes share their notes, so the tonic and its fifth decide between them
+    float bestScore = 0;
+    root = -1;
+    mode = -1;
+    for (int candidateMode = 0; candidateMode < numModes; candidateMode++)
+    {
+        for (int candidateRoot = 0; candidateRoot < 12; candidateRoot++)
+        {
+            juce::uint16 mask = scaleMask(candidateRoot, candidateMode);
+            float score = 0;
+            for (int pc = 0; pc < 12; pc++)
+            {
+                if (mask & (1 << pc))
+                    score += chroma[pc];
+            }
+            score += 0.5f * chroma[candidateRoot] + 0.25f * chroma[pitchClass(candidateRoot + modeIntervals[candidateMode][4])];
+            if (score > bestScore)
+            {
+                bestScore = score;
+                root = candidateRoot;
+                mode = candidateMode;
+            }
+        }
+    }
+    return root >= 0;
+}
+
+//Intervals above the chord root of each entry of chordSuffixes
+static constexpr juce::uint16 chordTypeMasks[numChordTypes] {
+    0x091,  // 0 4 7
+    0x089,  // 0 3 7
+    0x049,  // 0 3 6
+    0x111,  // 0 4 8
+    0x891,  // 0 4 7 11
+    0x491,  // 0 4 7 10
+    0x489,  // 0 3 7 10
+    0x449,  // 0 3 6 10
+    0x249,  // 0 3 6 9
+    0x889,  // 0 3 7 11
+    0x911   // 0 4 8 11
+};
+
+struct MaskTables
+{
+    MaskTables()
+    {
+        for (int scale = 0; scale < numScales; scale++)
+        {
+            juce::uint16 notes = scaleMask(scale % 12, scale / 12);
+            //Every subset of the scale, walked with the usual (subset - 1) & set trick
+            for (int subset = notes; ; subset = (subset - 1) & notes)
+            {
+                scales[subset].bits[scale >> 6] |= (juce::uint64)1 << (scale & 63);
+                if (subset == 0)
+                    break;
+            }
+        }
+
+        for (ChordMatch& chord : chords)
+            chord = { -1, -1 };
+        for (int type = 0; type < numChordTypes; type++)
+        {
+            for (int root = 0; root < 12; root++)
+            {
+                juce::uint16 mask = (juce::uint16)(((chordTypeMasks[type] << root) | (chordTypeMasks[type] >> (12 - root))) & 0xfff);
+                //Augmented and diminished sevenths are symmetrical, the first root found is kept
+                if (chords[mask].root < 0)
+                    chords[mask] = { root, type };
+            }
+        }
+    }
+
+    ScaleSet scales[4096] {};
+    ChordMatch chords[4096];
+};
+
+static const MaskTables& getMaskTables()
+{
+    static const MaskTables tables;
+    return tables;
+}
+
+const ScaleSet& scalesContaining(juce::uint16 mask)
+{
+    return getMaskTables().scales[mask & 0xfff];
+}
+
+ChordMatch chordFromMask(juce::uint16 mask)
+{
+    return getMaskTables().chords[mask & 0xfff];
+}
+
+struct ModulationTables
+{
+    ModulationTables()
+    {
+        //The diatonic chords of each scale, by mask and root since augmented triads share masks
+        struct Chord { juce::uint16 mask; int root; };
+        std::vector<Chord> triads[numScales], sevenths[numScales];
+        for (int scale = 0; scale < numScales; scale++)
+        {
+            for (int degree = 0; degree < 7; degree++)
+            {
+                int chordRoot = pitchClass(scale % 12 + modeIntervals[scale / 12][degree]);
+                triads[scale].push_back({ diatonicChordMask(scale % 12, scale / 12, degree, false), chordRoot });
+                sevenths[scale].push_back({ diatonicChordMask(scale % 12, scale / 12, degree, true), chordRoot });
+            }
+        }
+        auto shares = [](const std::vector<Chord>& chords, const Chord& chord)
+        {
+            return std::any_of(chords.begin(), chords.end(), [&chord](const Chord& c) { return c.mask == chord.mask && c.root == chord.root; });
+        };
+
+        //Pivots the way they are usually heard, as ii, IV or vi of the new key before its I, V, iii or vii
+        static constexpr int pivotDegrees[7] { 1, 3, 5, 0, 4, 2, 6 };
+        for (int from = 0; from < numScales; from++)
+        {
+            for (int to = 0; to < numScales; to++)
+            {
+                next[from][to] = -1;
+                cost[from][to] = from == to ? 0 : unreachable;
+                pivot[from][to] = { -1, -1 };
+                if (from == to)
+                    continue;
+
+                for (int degree : pivotDegrees)
+                {
+                    const Chord& chord = triads[to][(size_t)degree];
+                    if (shares(triads[from], chord))
+                    {
+                        pivot[from][to] = { chord.root, chordFromMask(chord.mask).type };
+                        break;
+                    }
+                }
+                if (pivot[from][to].root < 0)
+                    continue;
+
+                int sharedChords = 0;
+                for (int degree = 0; degree < 7; degree++)
+                {
+                    sharedChords += shares(triads[from], triads[to][(size_t)degree]) ? 1 : 0;
+                    sharedChords += shares(sevenths[from], sevenths[to][(size_t)degree]) ? 1 : 0;
+                }
+                int commonTones = juce::countNumberOfBits((juce::uint32)(scaleMask(from % 12, from / 12) & scaleMask(to % 12, to / 12)));
+                cost[from][to] = stepCost - sharedChords - commonTones;
+                next[from][to] = to;
+            }
+        }
+
+        for (int via = 0; via < numScales; via++)
+        {
+            for (int from = 0; from < numScales; from++)
+            {
+                if (cost[from][via] == unreachable)
+                    continue;
+                for (int to = 0; to < numScales; to++)
+                {
+                    if (cost[from][via] + cost[via][to] < cost[from][to])
+                    {
+                        cost[from][to] = cost[from][via] + cost[via][to];
+                        next[from][to] = next[from][via];
+                    }
+                }
+            }
+        }
+    }
+
+    //At most 14 chords and 7 notes are shared, so every step costs at least 3
+    static constexpr int stepCost = 24;
+    static constexpr int unreachable = 1 << 20;
+    int cost[numScales][numScales];
+    juce::int8 next[numScales][numScales];     // the first scale on the way
+    ChordMatch pivot[numScales][numScales];   // for scales a step apart
+};
+
+static const ModulationTables& getModulationTables()
+{
+    static const ModulationTables tables;
+    return tables;
+}
+
+ModulationRoute findModulationRoute(int fromScale, int toScale)
+{
+    const ModulationTables& tables = getModulationTables();
+    ModulationRoute route;
+    if (tables.cost[fromScale][toScale] == ModulationTables::unreachable)
+        return route;
+
+    route.cost = tables.cost[fromScale][toScale];
+    route.scales[0] = fromScale;
+    route.pivots[0] = { -1, -1 };
+    route.length = 1;
+    for (int scale = fromScale; scale != toScale && route.length < maxRouteLength; route.length++)
+    {
+        int nextScale = tables.next[scale][toScale];
+        route.scales[route.length] = nextScale;
+        route.pivots[route.length] = tables.pivot[scale][nextScale];
+        scale = nextScale;
+    }
+    return route;
+}
+
+static constexpr int naturalPitchClasses[7] { 0, 2, 4, 5, 7, 9, 11 };
+
+//Accidentals taking a letter to a pitch class, the nearer way round
+static int accidentalsBetween(int letter, int pc)
+{
+    return pitchClass(pc - naturalPitchClasses[letter] + 6) - 6;
+}
+
+void spellKey(int root, int mode, NoteSpelling* spellings)
+{
+    const int* intervals = modeIntervals[mode >= 0 ? mode : 0];
+
+    //The root letter giving the fewest accidentals, F# rather than Gb on a tie
+    int rootLetter = -1, fewest = 0;
+    for (int letter = 0; letter < 7; letter++)
+    {
+        if (std::abs(accidentalsBetween(letter, root)) > 1)
+            continue;
+        int count = 0;
+        for (int degree = 0; degree < 7; degree++)
+            count += std::abs(accidentalsBetween((letter + degree) % 7, root + intervals[degree]));
+        if (rootLetter < 0 || count < fewest)
+        {
+            rootLetter = letter;
+            fewest = count;
+        }
+    }
+
+    bool spelled[12] {};
+    int direction = 0;
+    for (int degree = 0; degree < 7; degree++)
+    {
+        int letter = (rootLetter + degree) % 7;
+        int pc = pitchClass(root + intervals[degree]);
+        spellings[pc] = { letter, accidentalsBetween(letter, pc) };
+        spelled[pc] = true;
+        direction += spellings[pc].accidentals;
+    }
+
+    for (int pc = 0; pc < 12; pc++)
+    {
+        if (spelled[pc])
+            continue;
+        const int* natural = std::find(std::begin(naturalPitchClasses), std::end(naturalPitchClasses), pc);
+        if (natural != std::end(naturalPitchClasses))
+            spellings[pc] = { (int)(natural - naturalPitchClasses), 0 };
+        else if (direction >= 0)
+            spellings[pc] = { (int)(std::find(naturalPitchClasses, naturalPitchClasses + 7, pc - 1) - naturalPitchClasses), 1 };
+        else
+            spellings[pc] = { (int)(std::find(naturalPitchClasses, naturalPitchClasses + 7, pitchClass(pc + 1)) - naturalPitchClasses), -1 };
+    }
+}
+
+juce::String spellingToString(NoteSpelling spelling, bool doReMi)
+{
+    static const char* const letters[7] { "C", "D", "E", "F", "G", "A", "B" };
+    static const char* const solfege[7] { "Do", "Re", "Mi", "Fa", "Sol", "La", "Si" };
+    juce::String name = (doReMi ? solfege : letters)[spelling.letter];
+    return name + juce::String::repeatedString(spelling.accidentals > 0 ? "#" : "b", std::abs(spelling.accidentals));
+}
+
+juce::Array<int> parseProgression(const juce::String& text)
+{
+    juce::Array<int> degrees;
+    juce::StringArray tokens;
+    tokens.addTokens(text.replaceCharacters(",-", "  "), " ", "");
+    tokens.removeEmptyStrings();
+
+    for (const juce::String& token : tokens)
+    {
+        //Chord qualities are implied by the mode, so anything after the numeral is ignored
+        juce::String numeral = token.toUpperCase().initialSectionContainingOnly("IV");
+        int degree = romanNumerals.indexOf(numeral);
+        if (degree < 0 && token.containsOnly("1234567"))
+            degree = token.getIntValue() - 1;
+        if (degree >= 0 && degree < 7)
+            degrees.add(degree);
+    }
+    return degrees;
+}
+
+juce::String progressionToString(const juce::Array<int>& degrees)
+{
+    juce::StringArray numerals;
+    for (int degree : degrees)
+        numerals.add(romanNumerals[degree]);
+    return numerals.joinIntoString(" ");
+}
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+/*
+  ==============================================================================
+
+    Scales and diatonic chords, shared by the processor and the editor.
+
+    Modes are numbered in the order of the mode menu without its "Notes" entry,
+    so mode 0 is Ionian and mode 8 is Melodic minor. Roots are pitch classes,
+    0 being C. Sets of pitch classes are 12 bit masks, bit 0 being C.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+static constexpr int numModes = 9;
+static constexpr int numScales = 12 * numModes;
+
+static constexpr int modeIntervals[numModes][7] {
+    { 0, 2, 4, 5, 7, 9, 11 },   // Ionian
+    { 0, 2, 3, 5, 7, 9, 10 },   // Dorian
+    { 0, 1, 3, 5, 7, 8, 10 },   // Phrygian
+    { 0, 2, 4, 6, 7, 9, 11 },   // Lydian
+    { 0, 2, 4, 5, 7, 9, 10 },   // Mixolydian
+    { 0, 2, 3, 5, 7, 8, 10 },   // Aeolian
+    { 0, 1, 3, 5, 6, 8, 10 },   // Locrian
+    { 0, 2, 3, 5, 7, 8, 11 },   // Harmonic minor
+    { 0, 2, 3, 5, 7, 9, 11 }    // Melodic minor
+};
+
+// The mode menu has "Notes" as item 1 and the modes from item 2 onwards
+inline int modeIndexFromMenuId(int menuItemId) { return menuItemId - 2; }
+inline int menuIdFromModeIndex(int modeIndex) { return modeIndex + 2; }
+
+static const char* const noteNames[12] { "C", "C#", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B" };
+
+inline int pitchClass(int note) { return ((note % 12) + 12) % 12; }
+
+inline juce::uint16 scaleMask(int root, int mode)
+{
+    juce::uint16 mask = 0;
+    for (int interval : modeIntervals[mode])
+        mask |= (juce::uint16)(1 << pitchClass(root + interval));
+    return mask;
+}
+
+// Semitones above the scale root of a note of the scale, counted in scale steps
+// from the root, continuing into the octaves above.
+inline int scaleStepOffset(int mode, int step)
+{
+    return modeIntervals[mode][step % 7] + 12 * (step / 7);
+}
+
+// Notes of the diatonic triad or seventh chord built on a degree (0..6), as
+// semitones above the scale root, in close position from the chord root.
+inline int diatonicChordOffsets(int mode, int degree, bool sevenths, int* offsets)
+{
+    int numNotes = sevenths ? 4 : 3;
+    for (int idx = 0; idx < numNotes; idx++)
+        offsets[idx] = scaleStepOffset(mode, degree + idx * 2);
+    return numNotes;
+}
+
+inline juce::uint16 diatonicChordMask(int root, int mode, int degree, bool sevenths)
+{
+    int offsets[4];
+    int numNotes = diatonicChordOffsets(mode, degree, sevenths, offsets);
+    juce::uint16 mask = 0;
+    for (int idx = 0; idx < numNotes; idx++)
+        mask |= (juce::uint16)(1 << pitchClass(root + offsets[idx]));
+    return mask;
+}
+
+// A note name as a letter and accidentals, e.g. F# is { 3, 1 } and Bb is { 6, -1 }
+struct NoteSpelling
+{
+    int letter;         // 0..6 from C
+    int accidentals;    // sharps above 0, flats below
+};
+
+// Spells every pitch class the way the key writes it: the scale notes with one
+// letter each, the rest as sharps in sharp keys and flats in flat keys. Mode -1
+// spells the major key of the root.
+void spellKey(int root, int mode, NoteSpelling* spellings /* [12] */);
+juce::String spellingToString(NoteSpelling spelling, bool doReMi);
+
+// Finds the root and mode whose scale best explains a 12 bin pitch class profile.
+// Returns false, with root and mode set to -1, when the profile is empty.
+bool findBestScale(const float* chroma, int& root, int& mode);
+
+//==============================================================================
+// Reverse lookups from a set of pitch classes, each a single table read.
+//
+// Scales are numbered mode * 12 + root. The tables cover all 4096 masks and
+// are built the first time they are used.
+struct ScaleSet
+{
+    juce::uint64 bits[2];
+
+    bool contains(int scale) const { return (bits[scale >> 6] >> (scale & 63)) & 1; }
+    bool isEmpty() const { return (bits[0] | bits[1]) == 0; }
+};
+
+// Every scale that has all of the notes in the mask
+const ScaleSet& scalesContaining(juce::uint16 mask);
+
+// Chord qualities that occur among the diatonic chords of the modes
+static constexpr int numChordTypes = 11;
+static const char* const chordSuffixes[numChordTypes] { "", "m", "dim", "aug", "maj7", "7", "m7", "m7b5", "dim7", "mMaj7", "maj7#5" };
+
+struct ChordMatch
+{
+    int root;   // -1 when the notes are not one of the chord types
+    int type;
+};
+
+// The chord made up of exactly the notes in the mask
+ChordMatch chordFromMask(juce::uint16 mask);
+
+//==============================================================================
+// Shortest pivot chord modulations between every pair of scales.
+//
+// Two scales are a step apart when they share a diatonic triad to pivot on, and
+// the step costs less the more diatonic chords and notes they have in common.
+// Routes between all pairs are found at once (Floyd-Warshall) the first time
+// one is asked for, after which a route is a few table reads.
+static constexpr int maxRouteLength = 12;
+
+struct ModulationRoute
+{
+    int length = 0;                         // scales on the route, 0 when there is none
+    int cost = 0;
+    int scales[maxRouteLength];             // from the first to the last
+    ChordMatch pivots[maxRouteLength];      // pivots[i] is a triad of both scales[i - 1] and scales[i]
+};
+
+ModulationRoute findModulationRoute(int fromScale, int toScale);
+
+// Parses a progression such as "I IV V I", "ii V I" or "1 6 4 5" into scale degrees 0..6
+juce::Array<int> parseProgression(const juce::String& text);
+juce::String progressionToString(const juce::Array<int>& degrees);
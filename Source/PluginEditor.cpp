@@ -34,114 +34,331 @@
 
 //==============================================================================
 
-SVGManager::SVGManager()
+//BinaryData names in the order of SVGManager::Layer, light mode first.
+//A skin pack overrides one by having an SVG with the original file name, e.g. LM_Ionian.svg
+static const char* const assetResourceNames[] {
+    "LM_Ionian_svg",
+    "LM_Dorian_svg",
+    "LM_Phrygian_svg",
+    "LM_Lydian_svg",
+    "LM_Mixolydian_svg",
+    "LM_Aeolian_svg",
+    "LM_Locrian_svg",
+    "LM_Modes_Background_svg",
+    "LM_Modes_Triads_svg",
+    "LM_Modes_7ths_svg",
+    "LM_Harmonic_minor_svg",
+    "LM_Harmonic_minor_Background_svg",
+    "LM_Harmonic_minor_Triads_svg",
+    "LM_Harmonic_minor_7ths_svg",
+    "LM_Melodic_minor_svg",
+    "LM_Melodic_minor_Background_svg",
+    "LM_Melodic_minor_Triads_svg",
+    "LM_Melodic_minor_7ths_svg",
+
+    "DM_Ionian_svg",
+    "DM_Dorian_svg",
+    "DM_Phrygian_svg",
+    "DM_Lydian_svg",
+    "DM_Mixolydian_svg",
+    "DM_Aeolian_svg",
+    "DM_Locrian_svg",
+    "DM_Modes_Background_svg",
+    "DM_Modes_Triads_svg",
+    "DM_Modes_7ths_svg",
+    "DM_Harmonic_minor_svg",
+    "DM_Harmonic_minor_Background_svg",
+    "DM_Harmonic_minor_Triads_svg",
+    "DM_Harmonic_minor_7ths_svg",
+    "DM_Melodic_minor_svg",
+    "DM_Melodic_minor_Background_svg",
+    "DM_Melodic_minor_Triads_svg",
+    "DM_Melodic_minor_7ths_svg"
+};
+
+SVGManager::SVGManager() : createdTicks(Time::getHighResolutionTicks())
+{
+    static_assert(sizeof(assetResourceNames) / sizeof(assetResourceNames[0]) == numAssets, "One resource per asset");
+
+    //Nothing is parsed until it is first drawn, just see which packs there are
+    for (int asset = 0; asset < numAssets; asset++)
+        assetFileNames[asset] = BinaryData::getNamedResourceOriginalFilename(assetResourceNames[asset]);
+    skinsDirectoryState = getSkinsDirectoryState();
+    openSkinPacks();
+    startTimer(skinsPollMs);
+}
+
+SVGManager::~SVGManager()
 {
-    replaceWrongDarkModeColour();
+    //Parses use the manager, so a running one is waited for however long it takes
+    urgentPool.removeAllJobs(true, -1);
 }
 
-Drawable* SVGManager::getCircleSvg()
+Drawable* SVGManager::get(Layer layer, bool dark)
 {
-    if (darkMode)
+    int asset = layer + (dark ? numLayers : 0);
+    Asset& entry = assets[asset];
+    if (entry.state.load(std::memory_order_acquire) == loaded)
+        return entry.drawable.get();
+
+    if (!entry.requested.exchange(true))
+        urgentPool.addJob([this, asset] { load(asset); });
+    return nullptr;
+}
+
+const String& SVGManager::getAssetKey(Layer layer, bool dark) const
+{
+    return assetKeys[layer + (dark ? numLayers : 0)];
+}
+
+//Built-in artwork only changes with the build
+static const String builtInSource = String("built-in ") + JucePlugin_VersionString;
+static Colour wrongDarkModeColour((uint8)41, (uint8)43, (uint8)44, (uint8)255);
+
+//Roughly what a parsed tree holds: each node, and the points of its paths or the pixels of its images
+static size_t estimateDrawableBytes(const Component& component)
+{
+    size_t bytes = sizeof(DrawableComposite);
+    if (auto* path = dynamic_cast<const DrawablePath*>(&component))
     {
-        return !circleModeDoRe ?
-            dmCircleC.get() :
-            dmCircleDo.get();
+        //Each element is stored as a marker followed by its coordinates
+        bytes = sizeof(DrawablePath);
+        for (Path::Iterator it(path->getPath()); it.next();)
+        {
+            int numPoints = it.elementType == Path::Iterator::cubicTo ? 3 : it.elementType == Path::Iterator::quadraticTo ? 2
+                : it.elementType == Path::Iterator::closePath ? 0 : 1;
+            bytes += sizeof(float) * (size_t)(1 + numPoints * 2);
+        }
     }
-    else
+    else if (auto* image = dynamic_cast<const DrawableImage*>(&component))
+        bytes = sizeof(DrawableImage) + (size_t)image->getImage().getWidth() * (size_t)image->getImage().getHeight() * 4;
+    else if (auto* text = dynamic_cast<const DrawableText*>(&component))
+        bytes = sizeof(DrawableText) + text->getText().getNumBytesAsUTF8();
+
+    for (const Component* child : component.getChildren())
+        bytes += estimateDrawableBytes(*child);
+    return bytes;
+}
+
+void SVGManager::load(int asset)
+{
+    int expected = queued;
+    if (!assets[asset].state.compare_exchange_strong(expected, parsing))
+        return;
+
+    //Drawables that are not on screen can be built off the message thread.
+    //The first pack with the asset wins, a pack entry that fails to parse falls back to the built-in one
+    std::unique_ptr<Drawable> drawable;
+    String source = builtInSource;
+    for (const std::unique_ptr<SkinPack>& pack : skinPacks)
+    {
+        if (pack->hasEntry(assetFileNames[asset]))
+        {
+            drawable = pack->createDrawable(assetFileNames[asset]);
+            if (drawable != nullptr)
+                source = pack->getEntrySignature(assetFileNames[asset]);
+            break;
+        }
+    }
+    if (drawable == nullptr)
+    {
+        int size = 0;
+        const char* data = BinaryData::getNamedResource(assetResourceNames[asset], size);
+        drawable = Drawable::createFromImageData(data, (size_t)size);
+    }
+    if (drawable != nullptr && asset >= numLayers)
+        drawable->replaceColour(wrongDarkModeColour, darkModeBackgroundColour);
+
+    assets[asset].bytes = drawable != nullptr ? estimateDrawableBytes(*drawable) : 0;
+    assets[asset].drawable = std::move(drawable);
+    assets[asset].source = source;
+    assets[asset].state.store(loaded, std::memory_order_release);
+    triggerAsyncUpdate();
+}
+
+String SVGManager::getSkinsDirectoryState() const
+{
+    String state;
+    for (const File& file : SkinPack::getSkinsDirectory().findChildFiles(File::findFiles, false, "*.zip"))
+        state << file.getFullPathName() << "|" << file.getLastModificationTime().toMilliseconds() << "|" << file.getSize() << "\n";
+    return state;
+}
+
+String SVGManager::getSource(int asset) const
+{
+    for (const std::unique_ptr<SkinPack>& pack : skinPacks)
+    {
+        if (pack->hasEntry(assetFileNames[asset]))
+            return pack->getEntrySignature(assetFileNames[asset]);
+    }
+    return builtInSource;
+}
+
+void SVGManager::openSkinPacks()
+{
+    skinPacks.clear();
+    Array<File> files = SkinPack::getSkinsDirectory().findChildFiles(File::findFiles, false, "*.zip");
+    files.sort();
+    for (const File& file : files)
+    {
+        if (std::unique_ptr<SkinPack> pack = SkinPack::open(file))
+            skinPacks.push_back(std::move(pack));
+        else
+            DBG("Not a skin pack: " << file.getFullPathName());
+    }
+    for (int asset = 0; asset < numAssets; asset++)
+        assetKeys[asset] = assetFileNames[asset] + "|" + getSource(asset);
+}
+
+void SVGManager::timerCallback()
+{
+    String state = getSkinsDirectoryState();
+    if (state == skinsDirectoryState)
+        return;
+    skinsDirectoryState = state;
+
+    //Workers read the packs, so let the parses in flight finish before swapping them, however long they take
+    urgentPool.removeAllJobs(true, -1);
+    openSkinPacks();
+
+    //Only assets whose source changed are dropped, they are parsed again when next drawn
+    bool changed = false;
+    for (int asset = 0; asset < numAssets; asset++)
+    {
+        Asset& entry = assets[asset];
+        if (entry.state.load(std::memory_order_acquire) != loaded)
+        {
+            //A job removed above may have been the only one for it
+            entry.requested = false;
+            continue;
+        }
+        if (getSource(asset) != entry.source)
+        {
+            entry.drawable.reset();
+            entry.requested = false;
+            entry.state.store(queued, std::memory_order_release);
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        DBG("Skin packs reloaded");
+        sendChangeMessage();
+    }
+}
+
+size_t SVGManager::getMemoryBytes(StringArray* perAsset) const
+{
+    size_t bytes = 0;
+    for (int asset = 0; asset < numAssets; asset++)
+    {
+        if (assets[asset].state.load(std::memory_order_acquire) != loaded)
+            continue;
+        bytes += assets[asset].bytes;
+        if (perAsset != nullptr)
+            perAsset->add(assetFileNames[asset] + ": " + MemoryBudget::formatBytes(assets[asset].bytes));
+    }
+    return bytes;
+}
+
+size_t SVGManager::getSkinPackBytes() const
+{
+    size_t bytes = 0;
+    for (const std::unique_ptr<SkinPack>& pack : skinPacks)
+        bytes += pack->getMemoryBytes();
+    return bytes;
+}
+
+void SVGManager::releaseDrawables()
+{
+    //The same as a changed skin, except that nothing needs drawing again
+    for (Asset& entry : assets)
+    {
+        if (entry.state.load(std::memory_order_acquire) != loaded)
+            continue;
+        entry.drawable.reset();
+        entry.bytes = 0;
+        entry.requested = false;
+        entry.state.store(queued, std::memory_order_release);
+    }
+}
+
+void SVGManager::handleAsyncUpdate()
+{
+    sendChangeMessage();
+}
+
+void SVGManager::framePainted(bool complete)
+{
+    if (!firstFramePainted)
     {
-        return !circleModeDoRe ?
-            lmCircleC.get() :
-            lmCircleDo.get();
+        firstFramePainted = true;
+        DBG("First frame after " << millisecondsSinceCreated() << " ms");
     }
+    if (complete && !completeFramePainted)
+    {
+        completeFramePainted = true;
+        DBG("First complete frame after " << millisecondsSinceCreated() << " ms");
+    }
+}
+
+double SVGManager::millisecondsSinceCreated() const
+{
+    return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - createdTicks) * 1000;
 }
 
-Drawable* SVGManager::getModeBackground(String mode)
+SVGManager::Layer SVGManager::getModeBackground(const String& mode)
 {
     if (mode == HARMONIC_MINOR)
-        return darkMode ? dmHarmonicMinorBackground.get() : lmHarmonicMinorBackground.get();
+        return harmonicMinorBackground;
     else if (mode == MELODIC_MINOR)
-        return darkMode ? dmMelodicMinorBackground.get() : lmMelodicMinorBackground.get();
+        return melodicMinorBackground;
     else
-        return darkMode ? dmModesBackground.get() : lmModesBackground.get();
+        return modesBackground;
 }
 
-Drawable* SVGManager::getModeImage(String mode)
+SVGManager::Layer SVGManager::getModeImage(const String& mode)
 {
-    Drawable* drawable = nullptr;
     if (mode == HARMONIC_MINOR)
-        drawable = darkMode ? dmHarmonicMinor.get() : lmHarmonicMinor.get();
+        return harmonicMinor;
     else if (mode == MELODIC_MINOR)
-        drawable = darkMode ? dmMelodicMinor.get() : lmMelodicMinor.get();
-    else if (mode == IONIAN)
-        drawable = darkMode ? dmIonian.get() : lmIonian.get();
+        return melodicMinor;
     else if (mode == DORIAN)
-        drawable = darkMode ? dmDorian.get() : lmDorian.get();
+        return dorian;
     else if (mode == PHRYGIAN)
-        drawable = darkMode ? dmPhrygian.get() : lmPhrygian.get();
+        return phrygian;
     else if (mode == LYDIAN)
-        drawable = darkMode ? dmLydian.get() : lmLydian.get();
+        return lydian;
     else if (mode == MIXOLYDIAN)
-        drawable = darkMode ? dmMixolydian.get() : lmMixolydian.get();
+        return mixolydian;
     else if (mode == AEOLIAN)
-        drawable = darkMode ? dmAeolian.get() : lmAeolian.get();
+        return aeolian;
     else if (mode == LOCRIAN)
-        drawable = darkMode ? dmLocrian.get() : lmLocrian.get();
-    return drawable;
+        return locrian;
+    else
+        return ionian;
 }
 
-Drawable* SVGManager::getModeTriads(String mode)
+SVGManager::Layer SVGManager::getModeTriads(const String& mode)
 {
     if (mode == HARMONIC_MINOR)
-        return darkMode ? dmHarmonicMinorTriads.get() : lmHarmonicMinorTriads.get();
+        return harmonicMinorTriads;
     else if (mode == MELODIC_MINOR)
-        return darkMode ? dmMelodicMinorTriads.get() : lmMelodicMinorTriads.get();
+        return melodicMinorTriads;
     else
-        return darkMode ? dmModesTriads.get() : lmModesTriads.get();
-    return nullptr;
+        return modesTriads;
 }
-Drawable* SVGManager::getModeSevenths(String mode)
+
+SVGManager::Layer SVGManager::getModeSevenths(const String& mode)
 {
     if (mode == HARMONIC_MINOR)
-        return darkMode ? dmHarmonicMinor7ths.get() : lmHarmonicMinor7ths.get();
+        return harmonicMinor7ths;
     else if (mode == MELODIC_MINOR)
-        return darkMode ? dmMelodicMinor7ths.get() : lmMelodicMinor7ths.get();
+        return melodicMinor7ths;
     else
-        return darkMode ? dmModes7ths.get() : lmModes7ths.get();
-    return nullptr;
+        return modes7ths;
 }
 
-static Colour wrongDarkModeColour((uint8)41, (uint8)43, (uint8)44, (uint8)255);
-static void replaceDarkModeColour(Drawable* drawable)
-{
-    bool found = drawable->replaceColour(wrongDarkModeColour, darkModeBackgroundColour);
-}
-
-void SVGManager::replaceWrongDarkModeColour()
-{
-    replaceDarkModeColour(dmCircleC.get());
-    replaceDarkModeColour(dmCircleDo.get());
-    replaceDarkModeColour(dmAeolian.get());
-    replaceDarkModeColour(dmDorian.get());
-    replaceDarkModeColour(dmIonian.get());
-    replaceDarkModeColour(dmLocrian.get());
-    replaceDarkModeColour(dmLydian.get());
-    replaceDarkModeColour(dmMixolydian.get());
-    replaceDarkModeColour(dmPhrygian.get());
-    replaceDarkModeColour(dmModesBackground.get());
-    replaceDarkModeColour(dmModesTriads.get());
-    replaceDarkModeColour(dmModes7ths.get());
-    replaceDarkModeColour(dmHarmonicMinor.get());
-    replaceDarkModeColour(dmHarmonicMinorBackground.get());
-    replaceDarkModeColour(dmHarmonicMinorTriads.get());
-    replaceDarkModeColour(dmHarmonicMinor7ths.get());
-    replaceDarkModeColour(dmMelodicMinor.get());
-    replaceDarkModeColour(dmMelodicMinorBackground.get());
-    replaceDarkModeColour(dmMelodicMinorTriads.get());
-    replaceDarkModeColour(dmMelodicMinor7ths.get());
-}
-
-
-
 static Rectangle<float> adjustedCircleBounds(Rectangle<int> circleBounds)
 {
     int buttonHeight = getButtonHeight(circleBounds);
@@ -152,65 +369,519 @@ static Rectangle<float> adjustedCircleBounds(Rectangle<int> circleBounds)
     return adjusted;
 }
 
-CircleComponent::CircleComponent(ComboBox* modeMenu)
+CircleComponent::CircleComponent(ComboBox* modeMenu, LayerCache& layerCache, const CircleSettings& settings)
+    : layerCache(layerCache), settings(settings)
 {
     setWantsKeyboardFocus(true);
     this->modeMenu = modeMenu;
-    noteToCircleIndexMap[0] = 0;
-    noteToCircleIndexMap[7] = 1;
-    noteToCircleIndexMap[2] = 2;
-    noteToCircleIndexMap[9] = 3;
-    noteToCircleIndexMap[4] = 4;
-    noteToCircleIndexMap[11] = 5;
-    noteToCircleIndexMap[6] = 6;
-    noteToCircleIndexMap[1] = 7;
-    noteToCircleIndexMap[8] = 8;
-    noteToCircleIndexMap[3] = 9;
-    noteToCircleIndexMap[10] = 10;
-    noteToCircleIndexMap[5] = 11;
+    svgManager->addChangeListener(this);
+}
+
+CircleComponent::~CircleComponent()
+{
+    svgManager->removeChangeListener(this);
+}
+
+int CircleComponent::getModeItemId() const
+{
+    return fixedModeItemId > 0 ? fixedModeItemId : modeMenu->getSelectedId();
+}
+
+String CircleComponent::getModeName() const
+{
+    return modes[(size_t)jmax(1, getModeItemId()) - 1];
+}
+
+void CircleComponent::setFixedMode(int modeItemId)
+{
+    if (modeItemId != fixedModeItemId)
+    {
+        fixedModeItemId = modeItemId;
+        repaint();
+    }
+}
+
+void CircleComponent::setCommonTones(bool shouldShow, uint16 mask)
+{
+    if (shouldShow != showCommonTones || mask != commonTones)
+    {
+        showCommonTones = shouldShow;
+        commonTones = mask;
+        repaint();
+    }
+}
+
+void CircleComponent::changeListenerCallback(ChangeBroadcaster*)
+{
+    //Another asset has been parsed
+    repaint();
 }
 
 void CircleComponent::paint(Graphics& g)
 {    
-    Rectangle<int> circleBounds = getBounds();
+    Rectangle<int> circleBounds = getLocalBounds();
     Rectangle<float> adjustedBounds = adjustedCircleBounds(circleBounds);
+    int layerSize = roundToInt(adjustedBounds.getWidth() * g.getInternalContext().getPhysicalPixelScaleFactor());
+    if (layerSize <= 0)
+        return;
+    lastLayerSize = layerSize;
 
-    int modeItemId = modeMenu->getSelectedId();
-    String selectedMode = modeMenu->getText();
+    //Only whole frames are timed, partial repaints such as the stats line would flatter the average
+    ICOF_LATENCY_MARK(paintStarted);
+    int64 startTicks = Time::getHighResolutionTicks();
+    bool inMotion = liveResizing || turning;
+    bool wholeFrame = g.getClipBounds().contains(getLocalBounds());
+    auto frameFinished = [&]
+    {
+        if (wholeFrame)
+            renderGovernor->frameFinished(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks) * 1000, inMotion);
+        paintRenderStats(g);
+        ICOF_LATENCY_MARK(paintEnded);
+    };
+
+    //The notes circle is generated, other EDOs have no mode artwork either
+    Colour ink = themeInk.value_or(settings.darkMode ? darkModeForegroundColour : Colour(0x1a, 0x1f, 0x20));
+    if (edo.getDivisions() != 12)
+    {
+        edo.paint(g, adjustedBounds, selectedNoteIndex, modeIndexFromMenuId(getModeItemId()), ink, layerSize);
+        svgManager->framePainted(true);
+        frameFinished();
+        return;
+    }
+
+    //While resizing, scaling cached images is good enough, the timer asks for full quality afterwards.
+    //In motion the governor may cut corners too, when the frames run over budget.
+    RenderGovernor::Level level = inMotion ? renderGovernor->getLevel() : RenderGovernor::fullQuality;
+    cachedLayersOnly = level >= RenderGovernor::cachedLayers;
+    nearestLayerSize = cachedLayersOnly ? layerSize / 2 : liveResizing ? layerSize : 0;
+    bool smooth = !liveResizing && level < RenderGovernor::nearestNeighbour;
+    g.setImageResamplingQuality(smooth ? Graphics::mediumResamplingQuality : Graphics::lowResamplingQuality);
+
+    //Layers still being parsed are drawn from a render at another size, if there is one, until they arrive
+    bool complete = true;
+    int modeItemId = getModeItemId();
+    String selectedMode = getModeName();
     if (modeItemId > 1)
-        svgManager.getModeBackground(selectedMode)->drawWithin(g, adjustedBounds, RectanglePlacement::centred, 1.0);
+        complete &= drawLayer(g, SVGManager::getModeBackground(selectedMode), adjustedBounds, layerSize);
     
-    //rotate based on the selected circle index
-    Drawable* notesCircleSvg = svgManager.getCircleSvg();
-    if (selectedRadians != 0)
-    {
-        float centreX = notesCircleSvg->getWidth()/2.0;
-        float centreY = notesCircleSvg->getHeight()/2.0;
-        float radians = -(selectedCircleIndex * 30 * (M_PI / 180));
-        AffineTransform transform(AffineTransform::rotation(radians, centreX, centreY));
-        notesCircleSvg->setTransform(transform);
-    }        
-    notesCircleSvg->drawWithin(g, adjustedBounds, RectanglePlacement::centred, 1.0);
+    updateNoteLabels();
+    edo.paintNotes(g, adjustedBounds, selectedNoteIndex, noteLabels, ink, layerSize);
 
     if (modeItemId > 1)
     {
-        svgManager.getModeImage(selectedMode)->drawWithin(g, adjustedBounds, RectanglePlacement::centred, 1.0);
-        if (currentTriadsAndSeventhsState == &TRIADS || currentTriadsAndSeventhsState == &SEVENTHS)
+        complete &= drawLayer(g, SVGManager::getModeImage(selectedMode), adjustedBounds, layerSize);
+        if (settings.chords == &TRIADS || settings.chords == &SEVENTHS)
         {
-            svgManager.getModeTriads(selectedMode)->drawWithin(g, adjustedBounds, RectanglePlacement::centred, 1.0);
-            if (currentTriadsAndSeventhsState == &SEVENTHS)
+            complete &= drawLayer(g, SVGManager::getModeTriads(selectedMode), adjustedBounds, layerSize);
+            if (settings.chords == &SEVENTHS && level < RenderGovernor::noSevenths)
             {
-                svgManager.getModeSevenths(selectedMode)->drawWithin(g, adjustedBounds, RectanglePlacement::centred, 1.0);
+                complete &= drawLayer(g, SVGManager::getModeSevenths(selectedMode), adjustedBounds, layerSize);
             }
         }        
     }
+    svgManager->framePainted(complete);
+
+    paintOverlays(g, adjustedBounds);
+    frameFinished();
+}
+
+void CircleComponent::paintRenderStats(Graphics& g)
+{
+    //Only on the main circle, comparison circles share the numbers
+    if (!renderGovernor->isShowingStats() || onSelected)
+        return;
+    int buttonHeight = getButtonHeight(getLocalBounds());
+    g.setColour(settings.darkMode ? darkModeForegroundColour : Colours::black);
+    g.setFont(buttonHeight * 0.5f);
+    g.drawText(renderGovernor->getStatsText() + ", " + memoryBudget->getSummary(), getLocalBounds().removeFromTop(buttonHeight).reduced(buttonHeight / 4, 0),
+        Justification::centredRight);
+}
+
+void CircleComponent::repaintRenderStats()
+{
+    repaint(getLocalBounds().removeFromTop(getButtonHeight(getLocalBounds())));
+}
+
+//Radii of the band the note names sit in, relative to the circle
+static constexpr float notesBandInner = 0.584f;
+static constexpr float notesBandOuter = 0.996f;
+static Colour detectedColour(232, 163, 61);
+static Colour heldColour(61, 140, 232);
+static Colour snappedColour(214, 72, 112);
+static Colour outOfScaleColour(226, 88, 52);
+static Colour routeColour(40, 150, 160);
+static Colour voiceLeadingColour(92, 158, 84);
+static Colour commonToneColour(180, 110, 200);
+
+void CircleComponent::paintOverlays(Graphics& g, Rectangle<float> bounds)
+{
+    if (showCommonTones)
+    {
+        g.setColour(commonToneColour.withAlpha(0.35f));
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if (commonTones & (1 << pc))
+                g.fillPath(getSectorPath(bounds, pc));
+        }
+        int buttonHeight = getButtonHeight(getLocalBounds());
+        String text = String(noteNames[selectedNoteIndex]) + " " + getModeName() + ", "
+            + String(countNumberOfBits((uint32)commonTones)) + " common";
+        g.setColour(settings.darkMode ? darkModeForegroundColour : Colours::black);
+        g.setFont(buttonHeight * 0.7f);
+        g.drawText(text, getLocalBounds().removeFromTop(buttonHeight).reduced(buttonHeight / 4, 0), Justification::centredLeft);
+    }
+
+    int mode = modeIndexFromMenuId(getModeItemId());
+    if (selectedChordDegree >= 0 && mode >= 0)
+    {
+        //The selected chord is outlined, the others show how far the voices have to move to reach them
+        float badgeSize = getButtonHeight(getLocalBounds()) * 0.9f;
+        g.setFont(badgeSize * 0.65f);
+        for (int degree = 0; degree < 7; degree++)
+        {
+            int chordRoot = ::pitchClass(selectedNoteIndex + modeIntervals[mode][degree]);
+            if (degree == selectedChordDegree)
+            {
+                g.setColour(voiceLeadingColour);
+                g.strokePath(getSectorPath(bounds, chordRoot), PathStrokeType(2.5f));
+                continue;
+            }
+            float angle = circleIndexOf(chordRoot) * MathConstants<float>::twoPi / 12;
+            Point<float> centre = bounds.getCentre() + Point<float>(std::sin(angle), -std::cos(angle)) * (bounds.getWidth() * 0.31f);
+            Rectangle<float> badge = Rectangle<float>(badgeSize, badgeSize).withCentre(centre);
+            g.setColour(voiceLeadingColour);
+            g.fillEllipse(badge);
+            g.setColour(Colours::white);
+            g.drawText(String(chordDistances[degree]), badge, Justification::centred, false);
+        }
+    }
+
+    if (heldNotesMask != 0)
+    {
+        //Notes outside the mode stand out, and a dot per octave shows where on the keyboard they are
+        uint16 scale = mode >= 0 ? scaleMask(selectedNoteIndex, mode) : (uint16)0xfff;
+        float inner = bounds.getWidth() * notesBandInner / 2;
+        float outer = bounds.getWidth() * notesBandOuter / 2;
+        float octaveStep = (outer - inner) / 11;
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if ((heldNotesMask & (1 << pc)) == 0)
+                continue;
+            Colour colour = (scale & (1 << pc)) != 0 ? heldColour : outOfScaleColour;
+            g.setColour(colour.withAlpha(0.35f));
+            g.fillPath(getSectorPath(bounds, pc));
+
+            g.setColour(colour);
+            float angle = circleIndexOf(pc) * MathConstants<float>::twoPi / 12;
+            Point<float> direction(std::sin(angle), -std::cos(angle));
+            for (int note = pc; note < 128; note += 12)
+            {
+                if (heldNotes.contains(note))
+                {
+                    Point<float> centre = bounds.getCentre() + direction * (inner + octaveStep * (note / 12 + 0.5f));
+                    g.fillEllipse(Rectangle<float>(octaveStep * 0.7f, octaveStep * 0.7f).withCentre(centre));
+                }
+            }
+        }
+    }
+
+    //Held notes that were snapped to the scale on the way in
+    if (snappedNotesMask != 0)
+    {
+        g.setColour(snappedColour);
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if (snappedNotesMask & (1 << pc))
+                g.strokePath(getSectorPath(bounds, pc), PathStrokeType(2.5f));
+        }
+    }
+
+    if (detectedChordMask != 0)
+    {
+        g.setColour(detectedColour.withAlpha(0.4f));
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if (detectedChordMask & (1 << pc))
+                g.fillPath(getSectorPath(bounds, pc));
+        }
+        g.setColour(detectedColour);
+        g.strokePath(getSectorPath(bounds, detectedChordRoot), PathStrokeType(2.0f));
+    }
+
+    paintModulationRoute(g, bounds);
+
+    if (detectedKeyRoot >= 0 || detectedChordRoot >= 0)
+    {
+        String text;
+        if (detectedKeyRoot >= 0)
+            text << "Key: " << noteNames[detectedKeyRoot] << " " << modes[detectedKeyMode + 1] << "   ";
+        if (detectedChordRoot >= 0)
+            text << "Chord: " << noteNames[detectedChordRoot];
+        int buttonHeight = getButtonHeight(getLocalBounds());
+        g.setColour(settings.darkMode ? darkModeForegroundColour : Colours::black);
+        g.setFont(buttonHeight * 0.7f);
+        g.drawText(text, getLocalBounds().removeFromBottom(buttonHeight).reduced(buttonHeight / 4, 0), Justification::centredLeft);
+    }
+}
+
+int CircleComponent::circleIndexOf(int pitchClass)
+{
+    return edo.circleIndexOf(pitchClass - selectedNoteIndex);
+}
+
+void CircleComponent::paintModulationRoute(Graphics& g, Rectangle<float> bounds)
+{
+    int target = hoveredScale >= 0 ? hoveredScale : modulationTarget;
+    int mode = modeIndexFromMenuId(getModeItemId());
+    if (target < 0 || mode < 0 || edo.getDivisions() != 12)
+        return;
+    ModulationRoute route = findModulationRoute(mode * 12 + selectedNoteIndex, target);
+    if (route.length == 0)
+        return;
+
+    //Arrows from root to root across the notes band, each key on the way outlined
+    float radius = bounds.getWidth() * (notesBandInner + notesBandOuter) / 4;
+    float width = bounds.getWidth();
+    auto rootPosition = [&](int scale)
+    {
+        float angle = circleIndexOf(scale % 12) * MathConstants<float>::twoPi / 12;
+        return bounds.getCentre() + Point<float>(std::sin(angle), -std::cos(angle)) * radius;
+    };
+    String text = String(noteNames[route.scales[0] % 12]) + " " + modes[route.scales[0] / 12 + 1];
+    g.setColour(routeColour);
+    for (int idx = 0; idx < route.length; idx++)
+    {
+        int scale = route.scales[idx];
+        g.strokePath(getSectorPath(bounds, scale % 12), PathStrokeType(2.0f));
+        if (idx == 0)
+            continue;
+
+        Line<float> line(rootPosition(route.scales[idx - 1]), rootPosition(scale));
+        if (line.getLength() > width * 0.1f)
+        {
+            Path arrow;
+            arrow.addArrow(line.withShortenedStart(width * 0.04f).withShortenedEnd(width * 0.04f), width * 0.008f, width * 0.035f, width * 0.03f);
+            g.fillPath(arrow);
+        }
+        const ChordMatch& pivot = route.pivots[idx];
+        text << "  > " << noteNames[pivot.root] << chordSuffixes[pivot.type] << " >  " << noteNames[scale % 12] << " " << modes[scale / 12 + 1];
+    }
+
+    int buttonHeight = getButtonHeight(getLocalBounds());
+    Rectangle<int> row = getLocalBounds().removeFromTop(buttonHeight * (showCommonTones ? 2 : 1)).removeFromBottom(buttonHeight);
+    g.setFont(buttonHeight * 0.6f);
+    g.drawFittedText(text, row.reduced(buttonHeight / 4, 0), Justification::centredLeft, 1);
+}
+
+Path CircleComponent::getSectorPath(Rectangle<float> bounds, int pitchClass)
+{
+    //Sectors are 30 degrees wide, centred on their note, clockwise from the top
+    float centre = circleIndexOf(pitchClass) * MathConstants<float>::twoPi / 12;
+    float halfSector = MathConstants<float>::pi / 12;
+    Rectangle<float> outer = bounds.withSizeKeepingCentre(bounds.getWidth() * notesBandOuter, bounds.getHeight() * notesBandOuter);
+    Path path;
+    path.addPieSegment(outer, centre - halfSector, centre + halfSector, notesBandInner / notesBandOuter);
+    return path;
+}
+
+void CircleComponent::setModulationTarget(int scale)
+{
+    if (scale != modulationTarget)
+    {
+        modulationTarget = scale;
+        repaint();
+    }
+}
+
+void CircleComponent::setHoveredScale(int scale)
+{
+    if (scale != hoveredScale)
+    {
+        hoveredScale = scale;
+        repaint();
+    }
+}
+
+void CircleComponent::setDetectedChord(int root, uint16 mask)
+{
+    if (root != detectedChordRoot || mask != detectedChordMask)
+    {
+        detectedChordRoot = root;
+        detectedChordMask = mask;
+        repaint();
+    }
+}
+
+void CircleComponent::setDetectedKey(int root, int mode)
+{
+    if (root != detectedKeyRoot || mode != detectedKeyMode)
+    {
+        detectedKeyRoot = root;
+        detectedKeyMode = mode;
+        repaint();
+    }
+}
+
+void CircleComponent::setChordDistances(int selectedDegree, const int* distances)
+{
+    int newDistances[7] = {};
+    if (distances != nullptr)
+        std::copy(distances, distances + 7, newDistances);
+    if (selectedDegree != selectedChordDegree || !std::equal(newDistances, newDistances + 7, chordDistances))
+    {
+        selectedChordDegree = selectedDegree;
+        std::copy(newDistances, newDistances + 7, chordDistances);
+        repaint();
+    }
+}
+
+void CircleComponent::prefetchAssets()
+{
+    //Asks for the layers of the current selection before the first paint does, unless the last session saved them
+    String selectedMode = getModeName();
+    if (getModeItemId() > 1)
+    {
+        for (SVGManager::Layer layer : { SVGManager::getModeBackground(selectedMode), SVGManager::getModeImage(selectedMode),
+                                         SVGManager::getModeTriads(selectedMode), SVGManager::getModeSevenths(selectedMode) })
+        {
+            if (!layerCache.isOnDisk(svgManager->getAssetKey(layer, settings.darkMode)))
+                svgManager->get(layer, settings.darkMode);
+        }
+    }
+}
+
+bool CircleComponent::prewarmMode(int modeIndex)
+{
+    if (liveResizing || turning || lastLayerSize <= 0)
+        return false;
+    if (modeIndex < 0 || edo.getDivisions() != 12)
+        return true;
+
+    //The same calls paint makes, so that it finds them in the cache
+    String modeName = modes[(size_t)menuIdFromModeIndex(modeIndex) - 1];
+    bool complete = true;
+    for (SVGManager::Layer layer : { SVGManager::getModeBackground(modeName), SVGManager::getModeImage(modeName),
+                                     SVGManager::getModeTriads(modeName), SVGManager::getModeSevenths(modeName) })
+    {
+        Image image = layerCache.getLayer(svgManager->getAssetKey(layer, settings.darkMode), lastLayerSize,
+            [this, layer] { return svgManager->get(layer, settings.darkMode); });
+        complete &= image.isValid();
+    }
+    return complete;
+}
+
+static uint16 foldToPitchClasses(const HeldNotes::Notes& notes)
+{
+    uint16 mask = 0;
+    for (int word = 0; word < 4; word++)
+    {
+        //The lowest set bit on its own, whose position is then the highest set bit
+        for (uint32 bits = notes.bits[word]; bits != 0; bits &= bits - 1)
+            mask |= (uint16)(1 << ::pitchClass(word * 32 + findHighestSetBit(bits & (~bits + 1))));
+    }
+    return mask;
+}
+
+void CircleComponent::setHeldNotes(const HeldNotes::Notes& notes)
+{
+    HeldNotes::Notes changed;
+    for (int word = 0; word < 4; word++)
+        changed.bits[word] = notes.bits[word] ^ heldNotes.bits[word];
+    heldNotes = notes;
+    heldNotesMask = foldToPitchClasses(notes);
+    repaintSectors(foldToPitchClasses(changed));
+}
+
+void CircleComponent::setSnappedNotes(uint16 mask)
+{
+    if (mask != snappedNotesMask)
+    {
+        repaintSectors(mask ^ snappedNotesMask);
+        snappedNotesMask = mask;
+    }
+}
+
+void CircleComponent::repaintSectors(uint16 mask)
+{
+    //Wide enough for the outlines drawn around them
+    Rectangle<float> bounds = adjustedCircleBounds(getLocalBounds());
+    for (int pc = 0; pc < 12; pc++)
+    {
+        if (mask & (1 << pc))
+            repaint(getSectorPath(bounds, pc).getBounds().getSmallestIntegerContainer().expanded(3));
+    }
+}
+
+bool CircleComponent::drawLayer(Graphics& g, SVGManager::Layer layer, Rectangle<float> bounds, int layerSize)
+{
+    //The SVG is only parsed when neither memory nor the disk has a render at this size
+    const String& asset = svgManager->getAssetKey(layer, settings.darkMode);
+    Image image;
+    if (nearestLayerSize > 0)
+        image = layerCache.getNearestLayer(asset, nearestLayerSize);
+    //Rendering is the most expensive thing a frame in motion could do, a layer never cached is left to the settle pass
+    if (!image.isValid() && cachedLayersOnly)
+        return false;
+    if (!image.isValid())
+        image = layerCache.getLayer(asset, layerSize, [this, layer] { return svgManager->get(layer, settings.darkMode); });
+    if (image.isValid())
+    {
+        g.drawImage(image, bounds);
+        return true;
+    }
+
+    //Until it is parsed, a render at another size stands in
+    image = layerCache.getNearestLayer(asset, layerSize);
+    if (image.isValid())
+        g.drawImage(image, bounds);
+    return false;
+}
+
+void CircleComponent::updateNoteLabels()
+{
+    //Only respelled when the key or the naming changes
+    int mode = modeIndexFromMenuId(getModeItemId());
+    int key = (selectedNoteIndex * (numModes + 1) + mode + 1) * 2 + (settings.doReMi ? 1 : 0);
+    if (key == noteLabelsKey)
+        return;
+    noteLabelsKey = key;
+    NoteSpelling spellings[12];
+    spellKey(selectedNoteIndex, mode, spellings);
+    for (int pc = 0; pc < 12; pc++)
+        noteLabels[pc] = spellingToString(spellings[pc], settings.doReMi);
+}
+
+void CircleComponent::resized()
+{
+    //Any resize after the first layout counts as a live resize until it has been idle for a moment
+    if (isShowing())
+    {
+        liveResizing = true;
+        startTimer(motionIdleMs);
+    }
+}
+
+void CircleComponent::setTheme(const Theme* theme)
+{
+    themeInk = theme != nullptr ? std::optional<Colour>(theme->ink) : std::nullopt;
+    repaint();
+}
+
+void CircleComponent::timerCallback()
+{
+    stopTimer();
+    liveResizing = false;
+    turning = false;
+    renderGovernor->idle();
+    repaint();
 }
 
  
 
 void CircleComponent::mouseDown(const MouseEvent& event)
 {
-    Rectangle<float> adjustedCircleBounds(adjustedCircleBounds(getBounds()));
+    ICOF_LATENCY_MARK(inputArrived);
+    Rectangle<float> adjustedCircleBounds(adjustedCircleBounds(getLocalBounds()));
     int centreX = adjustedCircleBounds.getCentreX();
     int centreY = adjustedCircleBounds.getCentreY();
 
@@ -223,65 +894,96 @@ void CircleComponent::mouseDown(const MouseEvent& event)
     if (!isInsideCircle)
         return;
 
+    //Comparison circles are not turned, clicking one makes it the main circle
+    if (onSelected)
+    {
+        onSelected();
+        return;
+    }
+
     int deltaX = mouseX - centreX;
     int deltaY = mouseY - centreY;
     float rad = std::atan2(deltaY, deltaX);
     float deg = rad * (180 / 3.14) + 90;
     if (deg < 0)
         deg += 360;
+
+    //Alt or right-click picks the diatonic chord on a note instead of turning the circle
+    int mode = modeIndexFromMenuId(getModeItemId());
+    if ((event.mods.isAltDown() || event.mods.isPopupMenu()) && edo.getDivisions() == 12 && mode >= 0)
+    {
+        int interval = edo.stepAt(edo.circleIndexAt(deg));
+        const int* degree = std::find(std::begin(modeIntervals[mode]), std::end(modeIntervals[mode]), interval);
+        if (degree != std::end(modeIntervals[mode]) && onChordClicked)
+            onChordClicked((int)(degree - std::begin(modeIntervals[mode])));
+        return;
+    }
     
     newCircleDegreeSelected(deg);
 }
 
-void CircleComponent::newCircleDegreeSelected(float deg)
+void CircleComponent::newCircleDegreeSelected(float deg)
+{
+    //Now we know the degree
+    //The last selected note decides the next jump
+    selectedRadians = -(deg * (3.14 / 180));
+    moveAround(edo.circleIndexAt(deg));
+}
+
+void CircleComponent::moveAround(int sectors)
+{
+    //Each sector clockwise is another generator up, a fifth in 12-EDO
+    if (sectors % edo.getDivisions() == 0)
+        return;
+    setRootStep(selectedNoteIndex + edo.stepAt(sectors));
+    if (onRootNoteChanged && edo.getDivisions() == 12)
+        onRootNoteChanged(selectedNoteIndex);
+}
+
+void CircleComponent::setRootNote(int pitchClass)
+{
+    rootPitchClass = ::pitchClass(pitchClass);
+    setRootStep(edo.stepFromPitchClass(rootPitchClass));
+}
+
+void CircleComponent::setRootStep(int step)
 {
-    //Now we know the degree
-    //The last selected note decides the next jump
-    selectedRadians = -(deg * (3.14 / 180));
-    if (deg >= 345 || deg < 15)
+    int divisions = edo.getDivisions();
+    selectedNoteIndex = ((step % divisions) + divisions) % divisions;
+    if (divisions == 12)
+        rootPitchClass = selectedNoteIndex;
+    ICOF_LATENCY_MARK(stateChanged);
+
+    //Arrow keys held down and scrubbing a timeline turn it in quick succession
+    if (isShowing())
     {
-        //same as current selection, no change needed
-        return;
+        turning = true;
+        startTimer(motionIdleMs);
     }
-
-    int adder = 0;
-    if (deg >= 15)
-        adder += 7;
-    if (deg >= 45)
-        adder += 7;
-    if (deg >= 75)
-        adder += 7;
-    if (deg >= 105)
-        adder += 7;
-    if (deg >= 135)
-        adder += 7;
-    if (deg >= 165)
-        adder += 7;
-    if (deg >= 195)
-        adder += 7;
-    if (deg >= 225)
-        adder += 7;
-    if (deg >= 255)
-        adder += 7;
-    if (deg >= 285)
-        adder += 7;
-    if (deg >= 315)
-        adder += 7;
-
-    int nextNoteIndex = (selectedNoteIndex + adder) % 12;
-    int nextCircleIndex = noteToCircleIndexMap[nextNoteIndex];
-    selectedNoteIndex = nextNoteIndex;
-    selectedCircleIndex = nextCircleIndex;
     repaint();
 }
 
+void CircleComponent::setEdo(int divisions, int generator)
+{
+    if (divisions == edo.getDivisions() && generator == edo.getGenerator())
+        return;
+    edo = EdoCircle(divisions, generator);
+    setRootStep(edo.stepFromPitchClass(rootPitchClass));
+}
+
+int CircleComponent::getRootNote() const
+{
+    return selectedNoteIndex;
+}
+
 InteractiveCircleOfFifthsAudioProcessorEditor::InteractiveCircleOfFifthsAudioProcessorEditor (InteractiveCircleOfFifthsAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p), circleComponent(&modeMenu)
+    : AudioProcessorEditor (&p), audioProcessor (p), circleComponent(&modeMenu, layerCache, circleSettings)
 {
     setWantsKeyboardFocus(true);    
     lightLookAndFeel.setLightModeLookAndFeel();
     darkLookAndFeel.setDarkModeLookAndFeel();
-    LookAndFeel::setDefaultLookAndFeel(&lightLookAndFeel);
+    //Set on this editor only, other instances may be in another theme and outlive it
+    setLookAndFeel(&lightLookAndFeel);
 
     setSize (400, 440);
     updateConstrainer();
@@ -292,19 +994,31 @@ InteractiveCircleOfFifthsAudioProcessorEditor::InteractiveCircleOfFifthsAudioPro
     {
         modeMenu.addItem(modes[idx], idx + 1);
     }
-    modeMenu.setSelectedId(1);
+    modeMenu.setSelectedId(menuIdFromModeIndex(audioProcessor.getModeIndex()), dontSendNotification);
     modeMenu.onChange = [this] { modeMenuChanged(); };
 
+    //The processor outlives the editor, so it is the one that remembers the selection
+    circleComponent.setRootNote(audioProcessor.getRootNote());
+    circleComponent.onRootNoteChanged = [this](int pitchClass)
+    {
+        audioProcessor.setRootNote(pitchClass);
+        int note = 60 + pitchClass;
+        audition(&note, 1, 0);
+    };
+    circleComponent.prefetchAssets();
+
     circleModeButton.setButtonText("C");
     circleModeButton.setTooltip("Show Do Re Mi");
     circleModeButton.addListener(this);
 
-    setSeventhsButtonNextState();
-    seventhsButton.setEnabled(false);
+    //The chord layer belongs to the processor, reopening the editor shows what it plays
+    TriadsAndSeventhsState* states[] { &NONE, &TRIADS, &SEVENTHS };
+    setTriadsAndSeventhsState(states[audioProcessor.getChordLayer()]);
+    seventhsButton.setEnabled(modeMenu.getSelectedId() > 1);
     seventhsButton.addListener(this);
 
     darkModeButton.setButtonText("D");
-    darkModeButton.setTooltip("Dark mode");
+    darkModeButton.setTooltip("Dark mode (Shift-click for more themes)");
     darkModeButton.setToggleable(true);
     darkModeButton.setToggleState(false, false);
     darkModeButton.addListener(this);
@@ -315,35 +1029,289 @@ InteractiveCircleOfFifthsAudioProcessorEditor::InteractiveCircleOfFifthsAudioPro
     halfWidthButton.setToggleState(false, false);
     halfWidthButton.addListener(this);
 
+    optionsButton.setButtonText("...");
+    optionsButton.setTooltip("More options");
+    optionsButton.addListener(this);
+
+    timelineComponent.onSegmentSelected = [this](const KeyTimeline::Segment& segment)
+    {
+        circleComponent.setRootNote(segment.root);
+        audioProcessor.setRootNote(segment.root);
+        modeMenu.setSelectedId(menuIdFromModeIndex(segment.mode));
+    };
+    timelineComponent.onCleared = [this] { resized(); };
+
+    circleComponent.onChordClicked = [this](int degree) { chordClicked(degree); };
+
+    scaleMatchList.onScaleSelected = [this](int root, int mode)
+    {
+        circleComponent.setRootNote(root);
+        audioProcessor.setRootNote(root);
+        modeMenu.setSelectedId(menuIdFromModeIndex(mode));
+    };
+    scaleMatchList.onScaleHovered = [this](int root, int mode)
+    {
+        circleComponent.setHoveredScale(root >= 0 ? mode * 12 + root : -1);
+    };
+
     addAndMakeVisible(modeMenu);
     addAndMakeVisible(circleModeButton);
     addAndMakeVisible(seventhsButton);
     addAndMakeVisible(darkModeButton);
     addAndMakeVisible(halfWidthButton);
+    addAndMakeVisible(optionsButton);
     addAndMakeVisible(circleComponent);
+    addChildComponent(timelineComponent);
+    addChildComponent(scaleMatchList);
+
+    //The rest of the appearance is kept by the processor while the editor is closed
+    const auto& editorSettings = audioProcessor.getEditorSettings();
+    setDoReMi(editorSettings.doReMi);
+    selectThemeByName(editorSettings.theme);
+    programVersion = editorSettings.programVersion;
+    pollProgram();
+
+    audioProcessor.getMidiRemote().setListening(true);
+    memoryBudget->addEditor(this);
+    startTimerHz(30);
 }
 
 InteractiveCircleOfFifthsAudioProcessorEditor::~InteractiveCircleOfFifthsAudioProcessorEditor()
 {
+    memoryBudget->removeEditor(this);
+    setLookAndFeel(nullptr);
+    audioProcessor.getMidiRemote().setListening(false);
+    audioProcessor.getEditorSettings() = { circleSettings.doReMi, getThemeName(), programVersion };
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::timerCallback()
+{
+    //Results from the audio side are polled, the audio thread never calls into the editor
+    AudioAnalyser& analyser = audioProcessor.getAudioAnalyser();
+    circleComponent.setDetectedChord(analyser.getChordRoot(), analyser.getChordMask());
+    circleComponent.setDetectedKey(analyser.getKeyRoot(), analyser.getKeyMode());
+
+    updateVoiceLeading();
+    updateComparison();
+
+    memoryBudget->update();
+    layerCache.saveToDiskWhenIdle();
+    SharedResourcePointer<RenderGovernor> renderGovernor;
+    if (renderGovernor->isShowingStats())
+        circleComponent.repaintRenderStats();
+
+    //The modes of the stored programs are rendered ahead, one per tick, so that a program change only draws them.
+    //Not while short of memory, they would only be let go again.
+    if (circleComponent.getLastLayerSize() != warmedLayerSize)
+    {
+        warmedLayerSize = circleComponent.getLastLayerSize();
+        queueProgramModes();
+    }
+    if (!modesToWarm.empty() && !memoryBudget->isUnderPressure() && circleComponent.prewarmMode(modesToWarm.back()))
+        modesToWarm.pop_back();
+}
+
+MemoryBudget::Usage InteractiveCircleOfFifthsAudioProcessorEditor::getMemoryUsage() const
+{
+    MemoryBudget::Usage usage;
+    usage.layers = layerCache.getMemoryBytes();
+    usage.noteCircles = circleComponent.getMemoryBytes();
+    for (const auto& circle : comparisonCircles)
+        usage.noteCircles += circle->getMemoryBytes();
+    usage.processor = audioProcessor.getMemoryBytes();
+    return usage;
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::releaseMemory(MemoryBudget::Release what)
+{
+    if (what == MemoryBudget::noteCircles)
+    {
+        circleComponent.releaseRenders();
+        for (auto& circle : comparisonCircles)
+            circle->releaseRenders();
+    }
+    else if (what == MemoryBudget::offscreenLayers)
+    {
+        //Up to four layers for each circle shown
+        layerCache.releaseAllBut(4 * (1 + (int)comparisonCircles.size()));
+    }
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::queueProgramModes()
+{
+    ProgramBank& bank = audioProcessor.getProgramBank();
+    modesToWarm.clear();
+    for (int idx = 0; idx < ProgramBank::numPrograms; idx++)
+    {
+        int mode = bank.getMode(idx);
+        if (mode >= 0 && std::find(modesToWarm.begin(), modesToWarm.end(), mode) == modesToWarm.end())
+            modesToWarm.push_back(mode);
+    }
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::pollProgram()
+{
+    //The host or the MIDI input may have changed the program, the processor has already switched scales
+    ProgramBank& bank = audioProcessor.getProgramBank();
+    uint32 version = bank.getVersion();
+    if (version == programVersion)
+        return;
+    programVersion = version;
+    applyProgram(bank.getProgram(bank.getCurrent()));
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::pollMidiRemote()
+{
+    //However many events arrived since the last frame, the circle moves once
+    MidiRemote& remote = audioProcessor.getMidiRemote();
+    MidiRemote::Event event;
+    int position = -1;
+    int modeItemId = 0;
+    int presses = 0;
+    while (remote.pop(event))
+    {
+        if (event.action == MidiRemote::turn)
+            position = event.value;
+        else if (event.action == MidiRemote::setMode)
+            modeItemId = menuIdFromModeIndex(event.value);
+        else
+            presses += event.value;
+    }
+
+    if (position >= 0)
+    {
+        int pitchClass = position * 7 % 12;
+        if (pitchClass != audioProcessor.getRootNote())
+        {
+            circleComponent.setRootNote(pitchClass);
+            audioProcessor.setRootNote(pitchClass);
+        }
+    }
+    if (modeItemId > 0 && modeItemId != modeMenu.getSelectedId())
+        modeMenu.setSelectedId(modeItemId, sendNotificationSync);
+    if (presses % 3 != 0)
+    {
+        for (int press = 0; press < presses % 3; press++)
+            setSeventhsButtonNextState();
+        circleComponent.repaint();
+    }
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::applyProgram(const ProgramBank::Program& program)
+{
+    //The root and mode come from the processor, a restored session may have turned the circle since
+    circleComponent.setRootNote(audioProcessor.getRootNote());
+    modeMenu.setSelectedId(menuIdFromModeIndex(audioProcessor.getModeIndex()), dontSendNotification);
+    seventhsButton.setEnabled(modeMenu.getSelectedId() > 1);
+    TriadsAndSeventhsState* states[] { &NONE, &TRIADS, &SEVENTHS };
+    setTriadsAndSeventhsState(states[audioProcessor.getChordLayer()]);
+    setDoReMi(program.doReMi);
+    selectThemeByName(program.theme);
+    repaint();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::storeProgram()
+{
+    ProgramBank& bank = audioProcessor.getProgramBank();
+    int index = bank.getCurrent();
+    ProgramBank::Program program = bank.getProgram(index);
+    program.root = audioProcessor.getRootNote();
+    program.mode = audioProcessor.getModeIndex();
+    program.chordLayer = circleSettings.chords->mode;
+    program.doReMi = circleSettings.doReMi;
+    program.theme = getThemeName();
+    bank.setProgram(index, program);
+    queueProgramModes();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::renameProgram()
+{
+    ProgramBank& bank = audioProcessor.getProgramBank();
+    int index = bank.getCurrent();
+    auto* window = new AlertWindow("Program name", String(), MessageBoxIconType::NoIcon, this);
+    window->addTextEditor("name", bank.getProgram(index).name);
+    window->addButton("OK", 1, KeyPress(KeyPress::returnKey));
+    window->addButton("Cancel", 0, KeyPress(KeyPress::escapeKey));
+    window->enterModalState(true, ModalCallbackFunction::create([window, &processor = audioProcessor, index](int result)
+    {
+        String name = window->getTextEditorContents("name").trim();
+        if (result == 1 && name.isNotEmpty())
+        {
+            processor.changeProgramName(index, name);
+            processor.updateHostDisplay(AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+        }
+    }), true);
+}
+
+String InteractiveCircleOfFifthsAudioProcessorEditor::getThemeName() const
+{
+    if (currentTheme.has_value())
+        return currentTheme->name;
+    return circleSettings.darkMode ? "Dark" : "Light";
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::selectThemeByName(const String& name)
+{
+    //Only a different theme re-renders the artwork
+    if (name == getThemeName())
+        return;
+    if (name == "Light" || name == "Dark")
+    {
+        circleSettings.darkMode = name == "Dark";
+        selectTheme(-1);
+        return;
+    }
+    if (themes.empty())
+        themes = loadThemes(audioProcessor.getTrackColour());
+    auto it = std::find_if(themes.begin(), themes.end(), [&name](const Theme& theme) { return theme.name == name; });
+    if (it != themes.end())
+        selectTheme((int)(it - themes.begin()));
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::pollHeldNotes()
+{
+    //The packed snapshot tells cheaply whether anything changed since the last frame
+    const HeldNotes& heldNotes = audioProcessor.getHeldNotes();
+    HeldNotes::Snapshot held = heldNotes.getSnapshot();
+    if (held.version != heldNotesVersion)
+    {
+        heldNotesVersion = held.version;
+        circleComponent.setHeldNotes(heldNotes.getNotes());
+        //Octaves of the same notes do not change the list
+        if (held.mask != listedNotesMask || held.bass != listedBass)
+        {
+            listedNotesMask = held.mask;
+            listedBass = held.bass;
+            scaleMatchList.setHeldNotes(held.mask, held.bass);
+            resized();
+        }
+    }
+    circleComponent.setSnappedNotes(audioProcessor.getScaleQuantiser().getSnappedNotes());
 }
 
 void InteractiveCircleOfFifthsAudioProcessorEditor::setSeventhsButtonNextState()
 {
-    TriadsAndSeventhsState* lastState = currentTriadsAndSeventhsState;
+    TriadsAndSeventhsState* lastState = circleSettings.chords;
     switch (lastState->mode)
     {
     case None:
-        currentTriadsAndSeventhsState = &TRIADS;
+        setTriadsAndSeventhsState(&TRIADS);
         break;
     case Triads:
-        currentTriadsAndSeventhsState = &SEVENTHS;
+        setTriadsAndSeventhsState(&SEVENTHS);
         break;
     case Sevenths:
-        currentTriadsAndSeventhsState = &NONE;
+        setTriadsAndSeventhsState(&NONE);
         break;
     }
-    seventhsButton.setButtonText(currentTriadsAndSeventhsState->buttonText);
-    seventhsButton.setTooltip(currentTriadsAndSeventhsState->buttonTooltip);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::setTriadsAndSeventhsState(TriadsAndSeventhsState* state)
+{
+    circleSettings.chords = state;
+    seventhsButton.setButtonText(circleSettings.chords->buttonText);
+    seventhsButton.setTooltip(circleSettings.chords->buttonTooltip);
+    audioProcessor.setChordLayer(circleSettings.chords->mode);
 }
 
 void InteractiveCircleOfFifthsAudioProcessorEditor::updateModeMenuSelection(bool up)
@@ -371,13 +1339,14 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::updateModeMenuSelection(bool
 
 bool InteractiveCircleOfFifthsAudioProcessorEditor::keyPressed(const KeyPress& k)
 {
+    ICOF_LATENCY_MARK(inputArrived);
     if (k.getKeyCode() == k.leftKey)
     {
-        circleComponent.newCircleDegreeSelected(30);
+        circleComponent.moveAround(1);
     }
     else if (k.getKeyCode() == k.rightKey)
     {
-        circleComponent.newCircleDegreeSelected(330);
+        circleComponent.moveAround(-1);
     }
     else if (k.getKeyCode() == k.upKey)
     {
@@ -401,9 +1370,28 @@ bool InteractiveCircleOfFifthsAudioProcessorEditor::keyPressed(const KeyPress& k
     return true;
 }
 
+bool InteractiveCircleOfFifthsAudioProcessorEditor::isInterestedInFileDrag(const StringArray& files)
+{
+    return files.size() == 1 && MidiFileAnalyser::isMidiFile(files[0]);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::filesDropped(const StringArray& files, int, int)
+{
+    //Analysed on background threads, the editor may be gone by the time it is done
+    midiFileAnalyser->analyseAsync(File(files[0]),
+        [safeThis = Component::SafePointer<InteractiveCircleOfFifthsAudioProcessorEditor>(this)](std::shared_ptr<const KeyTimeline> timeline)
+        {
+            if (safeThis == nullptr || timeline == nullptr)
+                return;
+            safeThis->timelineComponent.setTimeline(timeline);
+            safeThis->resized();
+        });
+}
+
 void InteractiveCircleOfFifthsAudioProcessorEditor::modeMenuChanged()
 {
     int modeItemId = modeMenu.getSelectedId();
+    audioProcessor.setModeIndex(modeIndexFromMenuId(modeItemId));
     if (modeItemId > 1)
         seventhsButton.setEnabled(true);
     else
@@ -415,9 +1403,7 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::buttonClicked(juce::Button*
 {
     if (button == &circleModeButton)
     {
-        circleModeDoRe = !circleModeDoRe;
-        circleModeButton.setButtonText(circleModeDoRe ? "Do" : "C");
-        circleModeButton.setTooltip(circleModeDoRe ? "Show C D E" : "Show Do Re Mi");
+        setDoReMi(!circleSettings.doReMi);
     }
     else if (button == &seventhsButton)
     {
@@ -425,19 +1411,23 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::buttonClicked(juce::Button*
     }
     else if (button == &darkModeButton)
     {
-        bool nextMode = !darkMode;
-        LookAndFeel::setDefaultLookAndFeel(
-            nextMode ?
-            &darkLookAndFeel :
-            &lightLookAndFeel
-        );
-        darkMode = nextMode;
-        darkModeButton.setToggleState(darkMode, false);
+        if (ModifierKeys::currentModifiers.isShiftDown())
+        {
+            darkModeButton.setToggleState(circleSettings.darkMode, false);
+            showThemeMenu();
+            return;
+        }
+        circleSettings.darkMode = currentTheme.has_value() ? false : !circleSettings.darkMode;
+        selectTheme(-1);
     }
     else if (button == &halfWidthButton)
     {
         toggleHalfWidth();
     }
+    else if (button == &optionsButton)
+    {
+        showOptionsMenu();
+    }
     repaint();
 }
 
@@ -450,7 +1440,12 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::paint (juce::Graphics& g)
         grabKeyboardFocus();
         firstTime = false;
     }
-    if (darkMode)
+    if (currentTheme.has_value())
+    {
+        g.fillAll(currentTheme->paper);
+        g.setColour(currentTheme->ink);
+    }
+    else if (circleSettings.darkMode)
     {
         g.fillAll(darkModeBackgroundColour);
         g.setColour(darkModeForegroundColour);
@@ -474,14 +1469,27 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::resized()
     seventhsButton.setBounds(Rectangle<int>(buttonHeight * 6.5 + buttonSpace * 3, buttonSpace, buttonHeight, buttonHeight));
     darkModeButton.setBounds(Rectangle<int>(buttonHeight * 7.5 + buttonSpace * 4, buttonSpace, buttonHeight, buttonHeight));
     halfWidthButton.setBounds(Rectangle<int>(buttonHeight * 8.5 + buttonSpace * 5, buttonSpace, buttonHeight, buttonHeight));
+    optionsButton.setBounds(Rectangle<int>(buttonHeight * 9.5 + buttonSpace * 6, buttonSpace, buttonHeight * 1.5, buttonHeight));
 
+    //The timeline of a dropped MIDI file takes a button's height off the bottom
+    int timelineHeight = timelineComponent.hasTimeline() ? buttonHeight + buttonSpace : 0;
     Rectangle<int> circleBounds = Rectangle<int>(
         bounds.getX(),// + buttonSpace,
         bounds.getY() + buttonHeight + buttonSpace,
         bounds.getWidth(),// - buttonSpace * 2,
-        bounds.getHeight() - buttonHeight - buttonSpace * 2
+        bounds.getHeight() - buttonHeight - buttonSpace * 2 - timelineHeight
     );
     circleComponent.setBounds(circleBounds);
+    layoutComparison(circleBounds);
+    timelineComponent.setVisible(timelineComponent.hasTimeline());
+    timelineComponent.setBounds(Rectangle<int>(buttonSpace, circleBounds.getBottom() + buttonSpace,
+        bounds.getWidth() - buttonSpace * 2, buttonHeight));
+
+    //Held notes list their scales in the top right corner, over the corner of the circle area
+    int listHeight = jmin(scaleMatchList.getIdealHeight(buttonHeight), circleBounds.getHeight());
+    scaleMatchList.setBounds(Rectangle<int>(bounds.getWidth() - buttonHeight * 5 - buttonSpace,
+        circleBounds.getY() + buttonSpace, buttonHeight * 5, listHeight));
+    scaleMatchList.setVisible(!scaleMatchList.isEmpty());
 }
 
 void InteractiveCircleOfFifthsAudioProcessorEditor::updateConstrainer()
@@ -505,6 +1513,518 @@ void InteractiveCircleOfFifthsAudioProcessorEditor::updateConstrainer()
     }
 }
 
+void InteractiveCircleOfFifthsAudioProcessorEditor::setDoReMi(bool shouldShowDoReMi)
+{
+    circleSettings.doReMi = shouldShowDoReMi;
+    circleModeButton.setButtonText(circleSettings.doReMi ? "Do" : "C");
+    circleModeButton.setTooltip(circleSettings.doReMi ? "Show C D E" : "Show Do Re Mi");
+    circleComponent.repaint();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::showThemeMenu()
+{
+    //Rebuilt every time so that edits to the user theme file and the host's track colour are picked up
+    themes = loadThemes(audioProcessor.getTrackColour());
+
+    PopupMenu menu;
+    menu.addItem(1, "Light", true, !currentTheme.has_value() && !circleSettings.darkMode);
+    menu.addItem(2, "Dark", true, !currentTheme.has_value() && circleSettings.darkMode);
+    menu.addSeparator();
+    for (int idx = 0; idx < (int)themes.size(); idx++)
+        menu.addItem(idx + 3, themes[idx].name, true, currentTheme.has_value() && currentTheme->name == themes[idx].name);
+
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&darkModeButton),
+        [safeThis = Component::SafePointer<InteractiveCircleOfFifthsAudioProcessorEditor>(this)](int result)
+        {
+            if (safeThis == nullptr || result == 0)
+                return;
+            if (result <= 2)
+            {
+                safeThis->circleSettings.darkMode = result == 2;
+                safeThis->selectTheme(-1);
+            }
+            else
+                safeThis->selectTheme(result - 3);
+        });
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::selectTheme(int index)
+{
+    if (index >= 0 && index < (int)themes.size())
+    {
+        //Themes recolour the light mode artwork
+        currentTheme = themes[index];
+        circleSettings.darkMode = false;
+        themeLookAndFeel.setThemeLookAndFeel(*currentTheme);
+        setLookAndFeel(&themeLookAndFeel);
+        layerCache.setTheme(&*currentTheme);
+        circleComponent.setTheme(&*currentTheme);
+        for (auto& circle : comparisonCircles)
+            circle->setTheme(&*currentTheme);
+    }
+    else
+    {
+        currentTheme.reset();
+        setLookAndFeel(circleSettings.darkMode ? &darkLookAndFeel : &lightLookAndFeel);
+        layerCache.setTheme(nullptr);
+        circleComponent.setTheme(nullptr);
+        for (auto& circle : comparisonCircles)
+            circle->setTheme(nullptr);
+    }
+    darkModeButton.setToggleState(circleSettings.darkMode || currentTheme.has_value(), false);
+    //Layers are rendered in the colours of the theme
+    queueProgramModes();
+    repaint();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::showOptionsMenu()
+{
+    ChordSequencer& sequencer = audioProcessor.getChordSequencer();
+    AudioAnalyser& analyser = audioProcessor.getAudioAnalyser();
+
+    //Selecting a program tells the host too, as if it had changed it
+    ProgramBank& bank = audioProcessor.getProgramBank();
+    PopupMenu programMenu;
+    for (int idx = 0; idx < ProgramBank::numPrograms; idx++)
+    {
+        programMenu.addItem(String(idx + 1) + ". " + bank.getProgram(idx).name, true, bank.getCurrent() == idx, [this, idx]
+        {
+            audioProcessor.setCurrentProgram(idx);
+            audioProcessor.updateHostDisplay(AudioProcessorListener::ChangeDetails().withProgramChanged(true));
+            pollProgram();
+        });
+    }
+    programMenu.addSeparator();
+    String programName = bank.getProgram(bank.getCurrent()).name;
+    programMenu.addItem("Store the circle in " + programName, [this] { storeProgram(); });
+    programMenu.addItem("Rename " + programName + "...", [this] { renameProgram(); });
+
+    PopupMenu menu;
+    menu.addSubMenu("Program: " + programName, programMenu);
+
+    //Learning binds whichever control is moved next
+    MidiRemote& remote = audioProcessor.getMidiRemote();
+    PopupMenu remoteMenu;
+    const char* actionNames[] { "Turn the circle", "Set the mode", "Cycle triads and sevenths" };
+    for (int action = 0; action < MidiRemote::numActions; action++)
+    {
+        auto remoteAction = (MidiRemote::Action)action;
+        String binding = remote.isLearning(remoteAction) ? String("move a control...") : MidiRemote::describeBinding(remote.getBinding(remoteAction));
+        remoteMenu.addItem(String(actionNames[action]) + ": " + binding, true, remote.isLearning(remoteAction), [&remote, remoteAction]
+        {
+            remote.learn(remoteAction);
+        });
+    }
+    remoteMenu.addSeparator();
+    remoteMenu.addItem("Forget all", [&remote]
+    {
+        for (int action = 0; action < MidiRemote::numActions; action++)
+            remote.forget((MidiRemote::Action)action);
+    });
+    menu.addSubMenu("MIDI control", remoteMenu);
+    menu.addSeparator();
+    String detectText = "Detect chords from audio input";
+    if (analyser.isEnabled())
+        detectText << " (" << String(analyser.getCpuLoad() * 100, 2) << "% CPU, "
+            << roundToInt(analyser.getLatencySeconds() * 1000) << " ms)";
+    menu.addItem(detectText, true, analyser.isEnabled(), [&analyser]
+    {
+        analyser.setEnabled(!analyser.isEnabled());
+    });
+    ScaleQuantiser& quantiser = audioProcessor.getScaleQuantiser();
+    PopupMenu snapMenu;
+    const char* snapNames[] { "Off", "To the nearest scale note", "Up", "Down", "Leave out notes outside the scale" };
+    for (int snap = 0; snap < ScaleQuantiser::numSnaps; snap++)
+    {
+        snapMenu.addItem(snapNames[snap], true, quantiser.getSnap() == snap, [&quantiser, snap]
+        {
+            quantiser.setSnap((ScaleQuantiser::Snap)snap);
+        });
+    }
+    menu.addSubMenu("Snap incoming notes to the scale", snapMenu);
+    menu.addSeparator();
+    menu.addItem("Play chord progression", true, sequencer.isEnabled(), [&sequencer]
+    {
+        sequencer.setEnabled(!sequencer.isEnabled());
+    });
+    menu.addItem("Progression: " + progressionToString(sequencer.getProgression()) + "...", [this]
+    {
+        editProgression();
+    });
+    menu.addSeparator();
+
+    TransitionPlayer& transitionPlayer = audioProcessor.getTransitionPlayer();
+    menu.addItem("Play voice leading of chords picked with alt-click", true, transitionPlayer.isEnabled(), [&transitionPlayer]
+    {
+        transitionPlayer.setEnabled(!transitionPlayer.isEnabled());
+    });
+    PopupMenu rangeMenu;
+    VoiceLeading& voiceLeading = audioProcessor.getVoiceLeading();
+    for (int lowestNote : { 36, 48, 60 })
+    {
+        String name = MidiMessage::getMidiNoteName(lowestNote, true, true, 4) + " - " + MidiMessage::getMidiNoteName(lowestNote + 24, true, true, 4);
+        rangeMenu.addItem(name, true, voiceLeading.getLowestNote() == lowestNote, [&voiceLeading, lowestNote]
+        {
+            voiceLeading.setRange(lowestNote, lowestNote + 24);
+        });
+    }
+    menu.addSubMenu("Voice leading range", rangeMenu);
+    menu.addSeparator();
+
+    AuditionSynth& synth = audioProcessor.getAuditionSynth();
+    String synthText = "Built-in synth";
+    if (synth.isEnabled())
+        synthText << " (" << String(synth.getCpuLoad() * 100, 2) << "% CPU, " << synth.getNumActiveVoices() << " voices)";
+    menu.addItem(synthText, true, synth.isEnabled(), [&synth]
+    {
+        synth.setEnabled(!synth.isEnabled());
+    });
+    bool canPlayScale = synth.isEnabled() && modeMenu.getSelectedId() > 1 && circleComponent.getEdo().getDivisions() == 12;
+    menu.addItem("Play the scale", canPlayScale, false, [this] { auditionScale(); });
+    menu.addSeparator();
+
+    PopupMenu compareMenu;
+    const char* comparisonNames[] { "Nothing", "Relative modes", "Parallel modes", "Neighbouring keys" };
+    for (int idx = 0; idx < 4; idx++)
+    {
+        compareMenu.addItem(comparisonNames[idx], true, comparison == idx, [this, idx]
+        {
+            comparison = idx;
+            updateComparison();
+        });
+    }
+    compareMenu.addSeparator();
+    for (int numCircles : { 2, 4 })
+    {
+        compareMenu.addItem(String(numCircles) + " circles", true, numComparisonCircles == numCircles - 1, [this, numCircles]
+        {
+            numComparisonCircles = numCircles - 1;
+            updateComparison();
+        });
+    }
+    menu.addSubMenu("Compare with", compareMenu, circleComponent.getEdo().getDivisions() == 12);
+
+    //Hovering a scale in the list of held note matches shows the route to it too
+    PopupMenu routeMenu;
+    routeMenu.addItem("Nothing", true, circleComponent.getModulationTarget() < 0, [this] { circleComponent.setModulationTarget(-1); });
+    for (int mode = 0; mode < numModes; mode++)
+    {
+        PopupMenu rootMenu;
+        for (int root = 0; root < 12; root++)
+        {
+            int scale = mode * 12 + root;
+            rootMenu.addItem(noteNames[root], true, circleComponent.getModulationTarget() == scale, [this, scale]
+            {
+                circleComponent.setModulationTarget(scale);
+            });
+        }
+        int target = circleComponent.getModulationTarget();
+        routeMenu.addSubMenu(modes[mode + 1], rootMenu, true, nullptr, target >= 0 && target / 12 == mode);
+    }
+    menu.addSubMenu("Modulation route to", routeMenu, circleComponent.getEdo().getDivisions() == 12 && modeMenu.getSelectedId() > 1);
+    menu.addSeparator();
+
+    //Circles of fifths for the usual microtonal EDOs, anything else can be typed in
+    PopupMenu tuningMenu;
+    const EdoCircle& edo = circleComponent.getEdo();
+    for (int divisions : { 12, 19, 31, 53 })
+    {
+        int generator = EdoCircle::fifthGenerator(divisions);
+        bool selected = edo.getDivisions() == divisions && edo.getGenerator() == generator;
+        tuningMenu.addItem(String(divisions) + "-EDO", true, selected, [this, divisions, generator]
+        {
+            circleComponent.setEdo(divisions, generator);
+        });
+    }
+    tuningMenu.addItem("Other...", [this] { editEdo(); });
+    menu.addSubMenu("Tuning: " + String(edo.getDivisions()) + "-EDO, generator " + String(edo.getGenerator()), tuningMenu);
+    menu.addSeparator();
+
+    //Lower budgets give up quality sooner while the circle is moving
+    SharedResourcePointer<RenderGovernor> renderGovernor;
+    PopupMenu budgetMenu;
+    for (double budgetMs : { 4.0, 8.0, 16.0, 33.0 })
+    {
+        budgetMenu.addItem(String(budgetMs, 0) + " ms", true, renderGovernor->getBudgetMs() == budgetMs, [renderGovernor, budgetMs]
+        {
+            renderGovernor->setBudgetMs(budgetMs);
+        });
+    }
+    budgetMenu.addSeparator();
+    budgetMenu.addItem("Show render stats", true, renderGovernor->isShowingStats(), [this, renderGovernor]
+    {
+        renderGovernor->setShowingStats(!renderGovernor->isShowingStats());
+        circleComponent.repaint();
+    });
+    menu.addSubMenu("Frame budget: " + String(renderGovernor->getBudgetMs(), 0) + " ms", budgetMenu);
+
+    //Shared by every instance, so that many of them on one machine stay within it together
+    PopupMenu memoryMenu;
+    for (int budgetMb : { 0, 64, 128, 256, 512 })
+    {
+        size_t budgetBytes = (size_t)budgetMb * 1024 * 1024;
+        memoryMenu.addItem(budgetMb == 0 ? String("No budget") : String(budgetMb) + " MB", true, memoryBudget->getBudgetBytes() == budgetBytes,
+            [this, budgetBytes]
+            {
+                memoryBudget->setBudgetBytes(budgetBytes);
+                memoryBudget->update();
+            });
+    }
+    memoryMenu.addSeparator();
+    memoryMenu.addItem("Show memory use...", [this]
+    {
+        String report = memoryBudget->getReport(*this);
+        DBG(report);
+        AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon, "Memory use", report);
+    });
+    menu.addSubMenu("Memory: " + MemoryBudget::formatBytes(memoryBudget->getTotalBytes()), memoryMenu);
+
+#if ICOF_DIAGNOSTICS
+    //Results go to a message box, and to the debug log to compare across runs
+    PopupMenu diagnosticsMenu;
+    diagnosticsMenu.addItem("Benchmark the built-in synth", []
+    {
+        String result = Diagnostics::benchmarkAuditionSynth();
+        DBG(result);
+        AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon, "Built-in synth", result);
+    });
+    diagnosticsMenu.addItem("Check real-time safety of the audio thread", []
+    {
+        String result = Diagnostics::checkRealtimeSafety();
+        DBG(result);
+        AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon, "Real-time safety", result);
+    });
+    diagnosticsMenu.addItem("Measure latency from input to screen", latencyHarness == nullptr, false, [this]
+    {
+        latencyHarness = std::make_unique<LatencyHarness>(*this, circleComponent, modeMenu, [this](const String& result)
+        {
+            DBG(result);
+            AlertWindow::showMessageBoxAsync(MessageBoxIconType::InfoIcon, "Input to screen latency", result);
+            //Not from inside the harness's own callback
+            MessageManager::callAsync([safeThis = Component::SafePointer<InteractiveCircleOfFifthsAudioProcessorEditor>(this)]
+            {
+                if (safeThis != nullptr)
+                    safeThis->latencyHarness.reset();
+            });
+        });
+    });
+    menu.addSubMenu("Diagnostics", diagnosticsMenu);
+#endif
+
+    menu.showMenuAsync(PopupMenu::Options().withTargetComponent(&optionsButton));
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::editProgression()
+{
+    ChordSequencer& sequencer = audioProcessor.getChordSequencer();
+    auto* window = new AlertWindow("Chord progression",
+        "Scale degrees of the selected root and mode, e.g. I IV V I or ii V I. One chord per bar.",
+        MessageBoxIconType::NoIcon, this);
+    window->addTextEditor("progression", progressionToString(sequencer.getProgression()));
+    window->addButton("OK", 1, KeyPress(KeyPress::returnKey));
+    window->addButton("Cancel", 0, KeyPress(KeyPress::escapeKey));
+    window->enterModalState(true, ModalCallbackFunction::create([window, &sequencer](int result)
+    {
+        if (result == 1)
+        {
+            Array<int> degrees = parseProgression(window->getTextEditorContents("progression"));
+            if (!degrees.isEmpty())
+                sequencer.setProgression(degrees);
+        }
+    }), true);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::editEdo()
+{
+    const EdoCircle& edo = circleComponent.getEdo();
+    auto* window = new AlertWindow("Tuning",
+        "Divisions of the octave (5 to 72), and the number of steps between neighbours on the circle.",
+        MessageBoxIconType::NoIcon, this);
+    window->addTextEditor("divisions", String(edo.getDivisions()), "Divisions");
+    window->addTextEditor("generator", String(edo.getGenerator()), "Generator");
+    window->addButton("OK", 1, KeyPress(KeyPress::returnKey));
+    window->addButton("Cancel", 0, KeyPress(KeyPress::escapeKey));
+    window->enterModalState(true, ModalCallbackFunction::create(
+        [window, safeThis = Component::SafePointer<InteractiveCircleOfFifthsAudioProcessorEditor>(this)](int result)
+        {
+            if (result != 1 || safeThis == nullptr)
+                return;
+            int divisions = window->getTextEditorContents("divisions").getIntValue();
+            String generatorText = window->getTextEditorContents("generator").trim();
+            int generator = generatorText.isEmpty() ? EdoCircle::fifthGenerator(divisions) : generatorText.getIntValue();
+            if (EdoCircle::isValid(divisions, generator))
+                safeThis->circleComponent.setEdo(divisions, generator);
+            else
+                AlertWindow::showMessageBoxAsync(MessageBoxIconType::WarningIcon, "Tuning",
+                    String(generator) + " steps of " + String(divisions) + "-EDO do not go round every note.");
+        }), true);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::chordClicked(int degree)
+{
+    //Picking a second chord plays the smoothest way there from the first, if asked to
+    int mode = modeIndexFromMenuId(modeMenu.getSelectedId());
+    std::shared_ptr<const VoiceLeadingTable> table = audioProcessor.getVoiceLeading().getTable(
+        circleComponent.getRootNote(), mode, circleSettings.chords == &SEVENTHS);
+    bool transition = audioProcessor.getTransitionPlayer().isEnabled();
+    if (transition && table != nullptr && selectedChordDegree >= 0 && degree != selectedChordDegree)
+    {
+        const VoiceLeadingTable::Voicing& from = table->voicings[selectedChordDegree][(size_t)table->bestFrom[selectedChordDegree][degree]];
+        const VoiceLeadingTable::Voicing& to = table->voicings[degree][(size_t)table->bestTo[selectedChordDegree][degree]];
+        TransitionPlayer::Transition transition{};
+        std::copy(from.notes, from.notes + from.numNotes, transition.from);
+        std::copy(to.notes, to.notes + to.numNotes, transition.to);
+        transition.numFrom = (int8)from.numNotes;
+        transition.numTo = (int8)to.numNotes;
+        audioProcessor.getTransitionPlayer().play(transition);
+    }
+    else if (degree != selectedChordDegree && mode >= 0)
+    {
+        //Without a transition to play the picked chord is heard on its own
+        int offsets[4];
+        int numNotes = diatonicChordOffsets(mode, degree, circleSettings.chords == &SEVENTHS, offsets);
+        for (int idx = 0; idx < numNotes; idx++)
+            offsets[idx] += 60 + circleComponent.getRootNote();
+        audition(offsets, numNotes, 0);
+    }
+    selectedChordDegree = degree == selectedChordDegree ? -1 : degree;
+    updateVoiceLeading();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::audition(const int* notes, int numNotes, float stepSeconds)
+{
+    AuditionSynth::Phrase phrase{};
+    phrase.numNotes = (int8)jmin(numNotes, (int)std::size(phrase.notes));
+    for (int idx = 0; idx < phrase.numNotes; idx++)
+        phrase.notes[idx] = (int8)jlimit(0, 127, notes[idx]);
+    phrase.stepSeconds = stepSeconds;
+    phrase.noteSeconds = stepSeconds > 0 ? stepSeconds * 0.9f : 0.8f;
+    audioProcessor.getAuditionSynth().play(phrase);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::auditionScale()
+{
+    //Up an octave from the root, ending on the root above
+    int mode = modeIndexFromMenuId(modeMenu.getSelectedId());
+    if (mode < 0)
+        return;
+    int notes[8];
+    for (int step = 0; step < 8; step++)
+        notes[step] = 60 + circleComponent.getRootNote() + scaleStepOffset(mode, step);
+    audition(notes, 8, 0.2f);
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::updateVoiceLeading()
+{
+    //Only a cache lookup, the tables are built in the background when the root or mode changes
+    int mode = modeIndexFromMenuId(modeMenu.getSelectedId());
+    if (mode < 0 || circleComponent.getEdo().getDivisions() != 12)
+        selectedChordDegree = -1;
+    if (selectedChordDegree < 0)
+    {
+        circleComponent.setChordDistances(-1, nullptr);
+        return;
+    }
+    std::shared_ptr<const VoiceLeadingTable> table = audioProcessor.getVoiceLeading().getTable(
+        circleComponent.getRootNote(), mode, circleSettings.chords == &SEVENTHS);
+    if (table != nullptr)
+        circleComponent.setChordDistances(selectedChordDegree, table->distance[selectedChordDegree]);
+}
+
+//Scales shown next to the main circle, as roots and mode indices
+static std::vector<std::pair<int, int>> getComparedScales(int comparison, int root, int mode)
+{
+    std::vector<std::pair<int, int>> scales;
+    bool diatonic = mode < 7;
+    if (comparison == 1 && diatonic)
+    {
+        //Same notes from another degree, the modes being in degree order from Ionian
+        for (int degree : { 5, 2, 1 })
+            scales.push_back({ pitchClass(root + modeIntervals[mode][degree]), (mode + degree) % 7 });
+    }
+    else if (comparison == 2 || comparison == 1)
+    {
+        //Harmonic and melodic minor have no relative modes in the menu, they get parallel ones
+        for (int other : { 5, 0, 4, 1, 3, 2, 6 })
+        {
+            if (other != mode && scales.size() < 3)
+                scales.push_back({ root, other });
+        }
+    }
+    else if (comparison == 3)
+    {
+        scales.push_back({ pitchClass(root + 7), mode });
+        scales.push_back({ pitchClass(root + 5), mode });
+        if (diatonic)
+            scales.push_back({ pitchClass(root + modeIntervals[mode][5]), (mode + 5) % 7 });
+        else
+            scales.push_back({ pitchClass(root + 2), mode });
+    }
+    return scales;
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::updateComparison()
+{
+    int root = circleComponent.getRootNote();
+    int mode = modeIndexFromMenuId(modeMenu.getSelectedId());
+    std::vector<std::pair<int, int>> scales;
+    if (mode >= 0 && circleComponent.getEdo().getDivisions() == 12)
+        scales = getComparedScales(comparison, root, mode);
+    if ((int)scales.size() > numComparisonCircles)
+        scales.resize((size_t)numComparisonCircles);
+    if (scales == comparedScales && (int)comparisonCircles.size() == (int)scales.size())
+        return;
+    comparedScales = scales;
+
+    while (comparisonCircles.size() > scales.size())
+        comparisonCircles.pop_back();
+    while (comparisonCircles.size() < scales.size())
+    {
+        int index = (int)comparisonCircles.size();
+        auto circle = std::make_unique<CircleComponent>(&modeMenu, layerCache, circleSettings);
+        circle->setTheme(currentTheme.has_value() ? &*currentTheme : nullptr);
+        circle->onSelected = [this, index]
+        {
+            auto [newRoot, newMode] = comparedScales[(size_t)index];
+            circleComponent.setRootNote(newRoot);
+            audioProcessor.setRootNote(newRoot);
+            modeMenu.setSelectedId(menuIdFromModeIndex(newMode));
+        };
+        addAndMakeVisible(*circle);
+        comparisonCircles.push_back(std::move(circle));
+    }
+
+    //Common tones are where the two scales' pitch class masks overlap
+    uint16 mainMask = mode >= 0 ? scaleMask(root, mode) : 0;
+    for (size_t idx = 0; idx < scales.size(); idx++)
+    {
+        comparisonCircles[idx]->setRootNote(scales[idx].first);
+        comparisonCircles[idx]->setFixedMode(menuIdFromModeIndex(scales[idx].second));
+        comparisonCircles[idx]->setCommonTones(true, mainMask & scaleMask(scales[idx].first, scales[idx].second));
+    }
+    resized();
+}
+
+void InteractiveCircleOfFifthsAudioProcessorEditor::layoutComparison(Rectangle<int> circleBounds)
+{
+    if (comparisonCircles.empty())
+        return;
+
+    //Two circles side by side, four in a square
+    int columns = 2;
+    int rows = comparisonCircles.size() > 1 ? 2 : 1;
+    int cellSize = jmin(circleBounds.getWidth() / columns, circleBounds.getHeight() / rows);
+    Rectangle<int> grid = Rectangle<int>(cellSize * columns, cellSize * rows).withCentre(circleBounds.getCentre()).withY(circleBounds.getY());
+    for (int idx = 0; idx <= (int)comparisonCircles.size(); idx++)
+    {
+        Rectangle<int> cell(grid.getX() + (idx % columns) * cellSize, grid.getY() + (idx / columns) * cellSize, cellSize, cellSize);
+        if (idx == 0)
+            circleComponent.setBounds(cell);
+        else
+            comparisonCircles[(size_t)idx - 1]->setBounds(cell);
+    }
+}
+
 void InteractiveCircleOfFifthsAudioProcessorEditor::toggleHalfWidth()
 {
     halfWidth = !halfWidth;
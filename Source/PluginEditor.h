@@ -32,14 +32,16 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "MidiFileAnalyser.h"
+#include "EdoCircle.h"
+#include "SkinPack.h"
+#include "Diagnostics.h"
 
 using namespace std;
 using namespace juce;
 using namespace BinaryData;
 
-static bool darkMode = false;
 static bool halfWidth = false;
-static bool circleModeDoRe = false;
 static Colour darkModeForegroundColour(236, 236, 236);
 static Colour darkModeBackgroundColour(36, 33, 33);
 static Colour darkModeSelectedBackgroundColour(95, 95, 95);
@@ -85,69 +87,161 @@ struct TriadsAndSeventhsState
 static TriadsAndSeventhsState NONE = { None, " ", "Show triads" };
 static TriadsAndSeventhsState TRIADS = { Triads, "T", "Show sevenths"};
 static TriadsAndSeventhsState SEVENTHS = { Sevenths, "7", "Don't show triads and sevenths"};
-static TriadsAndSeventhsState* currentTriadsAndSeventhsState = &SEVENTHS;
 
-static const unique_ptr<Drawable> svg(const char* data, size_t numBytes)
+// How an editor shows its circles. Each editor has its own, so that a program
+// change in one instance leaves the others as they are.
+struct CircleSettings
 {
-    return Drawable::createFromImageData(data, numBytes);
-}
+    bool darkMode = false;
+    bool doReMi = false;
+    TriadsAndSeventhsState* chords = &NONE;
+};
 
 //==============================================================================
-class SVGManager
+// A user definable palette. All of the artwork is drawn in ink on paper, so a
+// theme is applied to the cached light mode layers by mapping that luminance
+// ramp onto its own ink and paper colours.
+struct Theme
+{
+    String name;
+    Colour ink;
+    Colour paper;
+};
+
+std::vector<Theme> loadThemes(Colour trackColour);
+void applyTheme(Image& image, const Theme& theme);
+
+//==============================================================================
+// The circle artwork. Parsing every SVG up front held the editor back, so each
+// one is parsed on a worker thread the first time it is asked for, and getters
+// return nullptr until it is in.
+//
+// Skin packs in SkinPack::getSkinsDirectory() take precedence over the built-in
+// artwork. The directory is polled, and assets whose source changed are parsed
+// again. Their asset keys change with them, so renders of the old ones are not
+// drawn again.
+class SVGManager : public ChangeBroadcaster, private AsyncUpdater, private Timer
 {
 public:
+    enum Layer
+    {
+        ionian, dorian, phrygian, lydian, mixolydian, aeolian, locrian,
+        modesBackground, modesTriads, modes7ths,
+        harmonicMinor, harmonicMinorBackground, harmonicMinorTriads, harmonicMinor7ths,
+        melodicMinor, melodicMinorBackground, melodicMinorTriads, melodicMinor7ths,
+        numLayers
+    };
+
     SVGManager();
-    Drawable* getCircleSvg();
-    Drawable* getModeBackground(String mode);
-    Drawable* getModeImage(String mode);
-    Drawable* getModeTriads(String mode);
-    Drawable* getModeSevenths(String mode);
+    ~SVGManager() override;
+    static Layer getModeBackground(const String& mode);
+    static Layer getModeImage(const String& mode);
+    static Layer getModeTriads(const String& mode);
+    static Layer getModeSevenths(const String& mode);
+
+    // nullptr until parsed. Sends a change message whenever another asset has been parsed or a skin changed
+    Drawable* get(Layer layer, bool dark);
+    // The file name and the skin entry or build it comes from, in light or dark mode
+    const String& getAssetKey(Layer layer, bool dark) const;
+
+    // Records the time to the first frame, and to the first one without missing layers
+    void framePainted(bool complete);
+
+    // Estimated from each tree as it is parsed, optionally listed per asset
+    size_t getMemoryBytes(StringArray* perAsset = nullptr) const;
+    size_t getSkinPackBytes() const;
+    // Lets the parsed trees go, they are parsed again when a size not yet rendered is drawn
+    void releaseDrawables();
 
 private:
-    void replaceWrongDarkModeColour();
-
-    std::unique_ptr<Drawable> dmAeolian = svg(DM_Aeolian_svg, DM_Aeolian_svgSize);
-
-    std::unique_ptr<Drawable> lmCircleC = svg(LM_Notes_circle_C_svg, LM_Notes_circle_C_svgSize);
-    std::unique_ptr<Drawable> lmCircleDo = svg(LM_Notes_circle_Do_svg, LM_Notes_circle_Do_svgSize);
-    std::unique_ptr<Drawable> lmAeolian = svg(LM_Aeolian_svg, LM_Aeolian_svgSize);
-    std::unique_ptr<Drawable> lmDorian = svg(LM_Dorian_svg, LM_Dorian_svgSize);
-    std::unique_ptr<Drawable> lmIonian = svg(LM_Ionian_svg, LM_Ionian_svgSize);
-    std::unique_ptr<Drawable> lmLocrian = svg(LM_Locrian_svg, LM_Locrian_svgSize);
-    std::unique_ptr<Drawable> lmLydian = svg(LM_Lydian_svg, LM_Lydian_svgSize);
-    std::unique_ptr<Drawable> lmMixolydian = svg(LM_Mixolydian_svg, LM_Mixolydian_svgSize);
-    std::unique_ptr<Drawable> lmPhrygian = svg(LM_Phrygian_svg, LM_Phrygian_svgSize);
-    std::unique_ptr<Drawable> lmModesBackground = svg(LM_Modes_Background_svg, LM_Modes_Background_svgSize);
-    std::unique_ptr<Drawable> lmModesTriads = svg(LM_Modes_Triads_svg, LM_Modes_Triads_svgSize);
-    std::unique_ptr<Drawable> lmModes7ths = svg(LM_Modes_7ths_svg, LM_Modes_7ths_svgSize);
-    std::unique_ptr<Drawable> lmHarmonicMinor = svg(LM_Harmonic_minor_svg, LM_Harmonic_minor_svgSize);
-    std::unique_ptr<Drawable> lmHarmonicMinorBackground = svg(LM_Harmonic_minor_Background_svg, LM_Harmonic_minor_Background_svgSize);
-    std::unique_ptr<Drawable> lmHarmonicMinorTriads = svg(LM_Harmonic_minor_Triads_svg, LM_Harmonic_minor_Triads_svgSize);
-    std::unique_ptr<Drawable> lmHarmonicMinor7ths = svg(LM_Harmonic_minor_7ths_svg, LM_Harmonic_minor_7ths_svgSize);
-    std::unique_ptr<Drawable> lmMelodicMinor = svg(LM_Melodic_minor_svg, LM_Melodic_minor_svgSize);
-    std::unique_ptr<Drawable> lmMelodicMinorBackground = svg(LM_Melodic_minor_Background_svg, LM_Melodic_minor_Background_svgSize);
-    std::unique_ptr<Drawable> lmMelodicMinorTriads = svg(LM_Melodic_minor_Triads_svg, LM_Melodic_minor_Triads_svgSize);
-    std::unique_ptr<Drawable> lmMelodicMinor7ths = svg(LM_Melodic_minor_7ths_svg, LM_Melodic_minor_7ths_svgSize);
-
-    std::unique_ptr<Drawable> dmCircleC = svg(DM_Notes_circle_C_svg, DM_Notes_circle_C_svgSize);
-    std::unique_ptr<Drawable> dmCircleDo = svg(DM_Notes_circle_Do_svg, DM_Notes_circle_Do_svgSize);
-    std::unique_ptr<Drawable> dmDorian = svg(DM_Dorian_svg, DM_Dorian_svgSize);
-    std::unique_ptr<Drawable> dmIonian = svg(DM_Ionian_svg, DM_Ionian_svgSize);
-    std::unique_ptr<Drawable> dmLocrian = svg(DM_Locrian_svg, DM_Locrian_svgSize);
-    std::unique_ptr<Drawable> dmLydian = svg(DM_Lydian_svg, DM_Lydian_svgSize);
-    std::unique_ptr<Drawable> dmMixolydian = svg(DM_Mixolydian_svg, DM_Mixolydian_svgSize);
-    std::unique_ptr<Drawable> dmPhrygian = svg(DM_Phrygian_svg, DM_Phrygian_svgSize);
-    std::unique_ptr<Drawable> dmModesBackground = svg(DM_Modes_Background_svg, DM_Modes_Background_svgSize);
-    std::unique_ptr<Drawable> dmModesTriads = svg(DM_Modes_Triads_svg, DM_Modes_Triads_svgSize);
-    std::unique_ptr<Drawable> dmModes7ths = svg(DM_Modes_7ths_svg, DM_Modes_7ths_svgSize);
-    std::unique_ptr<Drawable> dmHarmonicMinor = svg(DM_Harmonic_minor_svg, DM_Harmonic_minor_svgSize);
-    std::unique_ptr<Drawable> dmHarmonicMinorBackground = svg(DM_Harmonic_minor_Background_svg, DM_Harmonic_minor_Background_svgSize);
-    std::unique_ptr<Drawable> dmHarmonicMinorTriads = svg(DM_Harmonic_minor_Triads_svg, DM_Harmonic_minor_Triads_svgSize);
-    std::unique_ptr<Drawable> dmHarmonicMinor7ths = svg(DM_Harmonic_minor_7ths_svg, DM_Harmonic_minor_7ths_svgSize);
-    std::unique_ptr<Drawable> dmMelodicMinor = svg(DM_Melodic_minor_svg, DM_Melodic_minor_svgSize);
-    std::unique_ptr<Drawable> dmMelodicMinorBackground = svg(DM_Melodic_minor_Background_svg, DM_Melodic_minor_Background_svgSize);
-    std::unique_ptr<Drawable> dmMelodicMinorTriads = svg(DM_Melodic_minor_Triads_svg, DM_Melodic_minor_Triads_svgSize);
-    std::unique_ptr<Drawable> dmMelodicMinor7ths = svg(DM_Melodic_minor_7ths_svg, DM_Melodic_minor_7ths_svgSize);
+    static constexpr int numAssets = numLayers * 2; // light mode, then dark mode
+
+    enum { queued, parsing, loaded };
+    struct Asset
+    {
+        std::unique_ptr<Drawable> drawable;
+        std::atomic<int> state{ queued };
+        std::atomic<bool> requested{ false };
+        String source;  // which pack entry it came from, if any
+        size_t bytes = 0;
+    };
+
+    void load(int asset);
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+    String getSkinsDirectoryState() const;
+    void openSkinPacks();
+    String getSource(int asset) const;
+    double millisecondsSinceCreated() const;
+
+    Asset assets[numAssets];
+    String assetFileNames[numAssets];
+    String assetKeys[numAssets];
+    // Only swapped on the message thread while no job is running
+    std::vector<std::unique_ptr<SkinPack>> skinPacks;
+    String skinsDirectoryState;
+    int64 createdTicks;
+    bool firstFramePainted = false;
+    bool completeFramePainted = false;
+    static constexpr int skinsPollMs = 1000;
+
+    // Declared after the assets and packs so that no job outlives them
+    ThreadPool urgentPool{ jlimit(1, 4, SystemStats::getNumCpus()) };
+};
+
+//==============================================================================
+// Keeps circle frames within a time budget when the message thread is crowded,
+// e.g. by many open editors and meters. Frames painted while the circle is in
+// motion are timed, and each time they average over the budget quality drops
+// another level. Levels are cumulative and only apply while in motion, so the
+// frame painted once things settle is always full quality, and an idle spell
+// without frames over budget brings the level back down.
+//
+// Shared by every circle in the process, and the budget is kept per machine in
+// the user's Settings.xml.
+class RenderGovernor
+{
+public:
+    enum Level
+    {
+        fullQuality,
+        cachedLayers,       // draw from lower resolution cached rasters, never render new ones
+        nearestNeighbour,   // no smoothing when scaling the rasters
+        noSevenths,         // leave the sevenths layer out
+        numLevels
+    };
+
+    RenderGovernor();
+
+    Level getLevel() const { return level; }
+    void frameFinished(double milliseconds, bool inMotion);
+    // Called once motion has stopped
+    void idle();
+
+    double getBudgetMs() const { return budgetMs; }
+    void setBudgetMs(double newBudgetMs);
+    bool isShowingStats() const { return showStats; }
+    void setShowingStats(bool shouldShow) { showStats = shouldShow; }
+    String getStatsText() const;
+
+    static const char* getLevelName(Level level);
+
+    // Machine specific settings, next to Themes.xml
+    static File getSettingsFile();
+
+private:
+    Level level = fullQuality;
+    double budgetMs = 8;
+    double averageMs = 0;
+    double worstMs = 0;
+    int64 numFrames = 0;
+    int64 numFramesOverBudget = 0;
+    int numLevelChanges = 0;
+    uint32 lastLevelChangeMs = 0;
+    uint32 lastOverBudgetMs = 0;
+    bool showStats = false;
+    static constexpr uint32 levelChangeIntervalMs = 250;
+    static constexpr uint32 recoveryMs = 2000;
 };
 
 //==============================================================================
@@ -160,6 +254,7 @@ public:
 
     void setLightModeLookAndFeel();
     void setDarkModeLookAndFeel();
+    void setThemeLookAndFeel(const Theme& theme);
 
     void drawRotarySlider(Graphics& g, int x, int y, int width, int height, float sliderPos,
         const float rotaryStartAngle, const float rotaryEndAngle, Slider& slider);
@@ -176,48 +271,347 @@ private:
 
 
 //==============================================================================
-class CircleComponent : public Component
+// Layer renders saved in the application data directory, so the first frame
+// after a launch needs no SVG parsed. One per process through a
+// SharedResourcePointer, so every editor reads the same mapping of the file
+// and only one of them ever writes it.
+//
+// A new file is written on a thread of its own, and only when it would hold
+// renders the current one lacks. Reads are locked against the swap to it.
+class LayerDiskCache
 {
 public:
-    CircleComponent(ComboBox* modeMenu);
+    LayerDiskCache();
+    ~LayerDiskCache();
+
+    bool contains(const String& asset) const;
+    // Invalid unless the asset was saved at this size
+    Image load(const String& asset, int size) const;
+    // Message thread. Does nothing while a write is still going.
+    void save(std::vector<std::pair<String, Image>> images);
+    size_t getMappedBytes() const;  // only resident as far as it has been read
+
+private:
+    struct Entry
+    {
+        int size;
+        int64 offset;   // of the pixels in the mapped file
+    };
+
+    static File getFile();
+    void map();
+    void write(const std::vector<std::pair<String, Image>>& images);
+
+    CriticalSection lock;
+    std::unique_ptr<MemoryMappedFile> mappedFile;
+    std::map<String, Entry> entries;
+    ThreadPool writer{ 1 };
+    static constexpr int formatVersion = 1;
+    static constexpr int64 maxBytes = 64 * 1024 * 1024;
+};
+
+//==============================================================================
+// Rasterised copies of the circle layers, keyed by SVGManager::getAssetKey().
+// Every full quality render also keeps a few downscaled levels, so that while
+// the window is being resized the circle can be composited from whichever
+// cached resolution is nearest.
+//
+// Once nothing new has been rendered for a while, the renders at the size last
+// drawn are handed to the LayerDiskCache. An asset key names the skin entry or
+// build the asset came from, so a changed asset renders afresh.
+class LayerCache
+{
+public:
+    // The drawable is only asked for when there is no render at this size, it may return nullptr
+    Image getLayer(const String& asset, int size, const std::function<Drawable*()>& getDrawable);
+    Image getNearestLayer(const String& asset, int size);
+    bool isOnDisk(const String& asset) const;
+    void setTheme(const Theme* theme);
+    // Called from a timer, cheap when there is nothing new to save
+    void saveToDiskWhenIdle();
+    void clear();
+    // Rasters held, themed and downscaled copies included
+    size_t getMemoryBytes() const;
+    // Lets all but the most recently drawn layers go
+    void releaseAllBut(int numKept);
+
+private:
+    struct Entry
+    {
+        std::vector<Image> levels; // largest first
+        std::vector<Image> themedLevels;
+        int themeVersion = -1;
+        int64 lastUsed = 0;
+    };
+
+    static Image render(Drawable* drawable, int size);
+    static size_t getBytes(const Entry& entry);
+    const std::vector<Image>& visibleLevels(Entry& entry);
+    void evictToBudget();
+
+    std::map<String, Entry> entries;
+    int64 useCounter = 0;
+    std::optional<Theme> theme;
+    int themeVersion = 0;
+    int lastSize = 0;
+    uint32 lastRenderMs = 0;
+    bool unsaved = false;
+    SharedResourcePointer<LayerDiskCache> diskCache;
+    // Full renders, their downscaled levels and themed copies together. The
+    // layers of one circle at a large size fit, the least recently drawn go first.
+    static constexpr size_t maxBytes = 64 * 1024 * 1024;
+    static constexpr int smallestLevel = 64;
+    static constexpr uint32 saveAfterIdleMs = 3000;
+};
+
+class InteractiveCircleOfFifthsAudioProcessorEditor;
+
+//==============================================================================
+// What the plugin holds in memory, per editor and across every instance in the
+// process. Caches are added up when asked rather than counted as they fill, so
+// painting pays nothing for it.
+//
+// With a budget set, going over it lets caches go in the order they are
+// cheapest to fill again: the timelines of dropped MIDI files, the note circle
+// renders, the layer rasters that are not on screen, and last the parsed
+// artwork. The budget is kept per machine in the user's Settings.xml.
+class MemoryBudget
+{
+public:
+    enum Release { timelines, noteCircles, offscreenLayers, artwork, numReleases };
+
+    struct Usage
+    {
+        size_t layers = 0;          // LayerCache rasters
+        size_t noteCircles = 0;     // EdoCircle rings and labels
+        size_t processor = 0;
+    };
+
+    MemoryBudget();
+
+    void addEditor(InteractiveCircleOfFifthsAudioProcessorEditor* editor);
+    void removeEditor(InteractiveCircleOfFifthsAudioProcessorEditor* editor);
+
+    size_t getBudgetBytes() const { return budgetBytes; }  // 0 for none
+    void setBudgetBytes(size_t newBudgetBytes);
+    // Once caches have had to go, until the budget changes, so that nothing fills them ahead of need
+    bool isUnderPressure() const { return underPressure; }
+
+    // Called from every editor's timer, adds up at most once a second
+    void update();
+
+    size_t getTotalBytes() const;
+    String getReport(const InteractiveCircleOfFifthsAudioProcessorEditor& editor) const;
+    // One line for the render stats
+    const String& getSummary() const { return summary; }
+
+    static String formatBytes(size_t bytes);
+
+private:
+    void release(Release what);
+
+    Array<InteractiveCircleOfFifthsAudioProcessorEditor*> editors;
+    size_t budgetBytes = 0;
+    bool underPressure = false;
+    String summary;
+    uint32 lastUpdateMs = 0;
+    static constexpr uint32 updateIntervalMs = 1000;
+};
+
+//==============================================================================
+class CircleComponent : public Component, public ChangeListener, private Timer
+{
+public:
+    CircleComponent(ComboBox* modeMenu, LayerCache& layerCache, const CircleSettings& settings);
+    ~CircleComponent() override;
     void paint(Graphics& g);
+    void resized() override;
     void mouseDown(const MouseEvent& event) override;
     void newCircleDegreeSelected(float deg);
+    void moveAround(int sectors);
+    void setRootNote(int pitchClass);
+    int getRootNote() const;
+    void setEdo(int divisions, int generator);
+    const EdoCircle& getEdo() const { return edo; }
+    // The note circle renders, the layer rasters belong to the LayerCache
+    size_t getMemoryBytes() const { return edo.getMemoryBytes(); }
+    void releaseRenders() { edo.clearRenders(); }
+    void setTheme(const Theme* theme);
+    void setDetectedChord(int root, uint16 mask);
+    void setDetectedKey(int root, int mode);
+    // Only the sectors of the pitch classes that changed are repainted
+    void setHeldNotes(const HeldNotes::Notes& notes);
+    void setSnappedNotes(uint16 mask);
+    void setChordDistances(int selectedDegree, const int* distances);
+    void prefetchAssets();
+    // Renders the layers of a mode at the size of the last frame, so that switching to it only has to draw them.
+    // Returns false while the circle is moving or an asset is still being parsed.
+    bool prewarmMode(int modeIndex);
+    int getLastLayerSize() const { return lastLayerSize; }
+    // Comparison circles have their own mode rather than the mode menu's
+    void setFixedMode(int modeItemId);
+    void setCommonTones(bool shouldShow, uint16 mask);
+    // Draws the shortest modulation from the current scale to one numbered mode * 12 + root, -1 for none.
+    // While a scale is hovered elsewhere the route to that one is drawn instead.
+    void setModulationTarget(int scale);
+    int getModulationTarget() const { return modulationTarget; }
+    void setHoveredScale(int scale);
+    void changeListenerCallback(ChangeBroadcaster* source) override;
+    void repaintRenderStats();
+
+    std::function<void(int)> onRootNoteChanged;
+    std::function<void(int degree)> onChordClicked;
+    std::function<void()> onSelected;
 
 private:
-    const std::unique_ptr<Drawable> lmModesGeneralBackgroundSvg = Drawable::createFromImageData(BinaryData::Modes_general_background_svg, BinaryData::Modes_general_background_svgSize);
-    const std::unique_ptr<Drawable> lmNotesCircleSvg = Drawable::createFromImageData(BinaryData::Notes_circle_svg, BinaryData::Notes_circle_svgSize);
-
-    const std::unique_ptr<Drawable> lmModeLydianSvg = Drawable::createFromImageData(BinaryData::Mode_Lydian_svg, BinaryData::Mode_Lydian_svgSize);
-    const std::unique_ptr<Drawable> lmModeDorianSvg = Drawable::createFromImageData(BinaryData::Mode_Dorian_svg, BinaryData::Mode_Dorian_svgSize);
-    const std::unique_ptr<Drawable> lmModeLocrianSvg = Drawable::createFromImageData(BinaryData::Mode_Locrian_svg, BinaryData::Mode_Locrian_svgSize);
-    const std::unique_ptr<Drawable> lmModeAeolianSvg = Drawable::createFromImageData(BinaryData::Mode_Aeolian_svg, BinaryData::Mode_Aeolian_svgSize);
-    const std::unique_ptr<Drawable> lmModeIonianSvg = Drawable::createFromImageData(BinaryData::Mode_Ionian_svg, BinaryData::Mode_Ionian_svgSize);
-    const std::unique_ptr<Drawable> lmModePhrygianSvg = Drawable::createFromImageData(BinaryData::Mode_Phrygian_svg, BinaryData::Mode_Phrygian_svgSize);
-    const std::unique_ptr<Drawable> lmModeMixolydianSvg = Drawable::createFromImageData(BinaryData::Mode_Mixolydian_svg, BinaryData::Mode_Mixolydian_svgSize);
-
-    std::vector<Drawable*> lmModes{
-        nullptr,
-        lmModeLydianSvg.get(),
-        lmModeDorianSvg.get(),
-        lmModeLocrianSvg.get(),
-        lmModeAeolianSvg.get(),
-        lmModeIonianSvg.get(),
-        lmModePhrygianSvg.get(),
-        lmModeMixolydianSvg.get()    
-    };
-
-    const unique_ptr<Drawable> dmNotesCircleSvg = svg(Notes_circle_Dark_mode_svg, Notes_circle_Dark_mode_svgSize);
+    void timerCallback() override;
+    bool drawLayer(Graphics& g, SVGManager::Layer layer, Rectangle<float> bounds, int layerSize);
+    void updateNoteLabels();
+    void paintOverlays(Graphics& g, Rectangle<float> bounds);
+    void paintModulationRoute(Graphics& g, Rectangle<float> bounds);
+    void paintRenderStats(Graphics& g);
+    void setRootStep(int step);
+    int getModeItemId() const;
+    String getModeName() const;
+    int circleIndexOf(int pitchClass);
+    Path getSectorPath(Rectangle<float> bounds, int pitchClass);
+    void repaintSectors(uint16 mask);
 
     float selectedRadians = 0;
-    int selectedNoteIndex = 0;
-    int selectedCircleIndex = 0;
-    std::map<int, int> noteToCircleIndexMap;
+    int selectedNoteIndex = 0;  // a step of the EDO, which is a pitch class in 12-EDO
+    int rootPitchClass = 0;     // the last 12-EDO root, kept when switching to other EDOs
+    EdoCircle edo;
+    // Spelled for the current key, per pitch class, and what they were spelled for
+    String noteLabels[12];
+    int noteLabelsKey = -1;
+    std::optional<Colour> themeInk;
     ComboBox* modeMenu;
-    SVGManager svgManager;
+    // Parsed once per process, and rendered once per editor however many circles it shows
+    SharedResourcePointer<SVGManager> svgManager;
+    LayerCache& layerCache;
+    const CircleSettings& settings;
+    int fixedModeItemId = 0;
+    bool showCommonTones = false;
+    uint16 commonTones = 0;
+    bool liveResizing = false;
+    bool turning = false;
+    int nearestLayerSize = 0;   // when > 0 layers are drawn from this cached size, or the nearest one
+    bool cachedLayersOnly = false;
+    int lastLayerSize = 0;
+    SharedResourcePointer<RenderGovernor> renderGovernor;
+    SharedResourcePointer<MemoryBudget> memoryBudget;
+    static constexpr int motionIdleMs = 150;
+
+    int detectedChordRoot = -1;
+    uint16 detectedChordMask = 0;
+    int detectedKeyRoot = -1;
+    int detectedKeyMode = -1;
+    HeldNotes::Notes heldNotes{};
+    uint16 heldNotesMask = 0;
+    uint16 snappedNotesMask = 0;
+    int selectedChordDegree = -1;
+    int chordDistances[7] = {};
+    int modulationTarget = -1;
+    int hoveredScale = -1;
+};
+//==============================================================================
+// The keys and modes of a dropped MIDI file, scrubbing it rotates the circle
+class TimelineComponent : public Component, public SettableTooltipClient
+{
+public:
+    void setTimeline(std::shared_ptr<const KeyTimeline> newTimeline);
+    bool hasTimeline() const { return timeline != nullptr; }
+    void paint(Graphics& g) override;
+    void mouseDown(const MouseEvent& event) override;
+    void mouseDrag(const MouseEvent& event) override;
+
+    std::function<void(const KeyTimeline::Segment&)> onSegmentSelected;
+    std::function<void()> onCleared;
+
+private:
+    void scrubTo(float x);
+
+    std::shared_ptr<const KeyTimeline> timeline;
+    double position = -1;
+    const KeyTimeline::Segment* selectedSegment = nullptr;
 };
+
 //==============================================================================
-class InteractiveCircleOfFifthsAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Button::Listener
+// The chord and every scale containing the held MIDI notes, best fit first
+class ScaleMatchList : public Component
+{
+public:
+    void setHeldNotes(uint16 mask, int bass);
+    bool isEmpty() const { return heading.isEmpty(); }
+    int getIdealHeight(int rowHeight) const;
+    void paint(Graphics& g) override;
+    void mouseMove(const MouseEvent& event) override;
+    void mouseExit(const MouseEvent& event) override;
+    void mouseDown(const MouseEvent& event) override;
+
+    std::function<void(int root, int mode)> onScaleSelected;
+    // -1 for both when the mouse leaves the rows
+    std::function<void(int root, int mode)> onScaleHovered;
+
+private:
+    int rowAt(float y) const;
+    void setHoverRow(int row);
+
+    struct Match
+    {
+        int root;
+        int mode;
+        int score;
+    };
+    String heading;
+    std::vector<Match> matches;
+    int hoverRow = -1;
+    static constexpr int maxRows = 12;
+};
+
+#if ICOF_DIAGNOSTICS
+//==============================================================================
+// Arrow keys and clicks injected into the editor at a few sizes and in every
+// mode, each timed from its handler to the frame on screen. A frame counts as
+// presented at the first vertical blank after the circle was painted.
+class LatencyHarness : private Timer
+{
+public:
+    LatencyHarness(Component& editor, CircleComponent& circle, ComboBox& modeMenu, std::function<void(const String&)> onFinished);
+
+private:
+    void timerCallback() override;
+    void startInteraction();
+    void nextInteraction();
+    String describe();
+
+    Component& editor;
+    CircleComponent& circle;
+    ComboBox& modeMenu;
+    std::function<void(const String&)> onFinished;
+    Rectangle<int> originalBounds;
+    int originalModeId;
+    int originalRoot;
+
+    static constexpr int numSizes = 3;
+    static constexpr float sizes[numSizes] { 0.7f, 1.0f, 1.4f };
+    static constexpr int interactionsPerSetting = 10;
+    static constexpr double timeoutMs = 1000;
+    int setting = 0;        // size * number of modes + mode
+    int interaction = -1;   // -1 warms up the layers after a change of setting
+    bool waiting = false;
+    int64 startTicks = 0;
+    Random random;
+
+    std::vector<double> latencies[Diagnostics::numLatencyStages][2];   // [stage][key, click]
+    std::vector<double> presentedBySize[numSizes];
+    int numTimedOut = 0;
+};
+#endif
+
+//==============================================================================
+class InteractiveCircleOfFifthsAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Button::Listener,
+    public FileDragAndDropTarget, private Timer
 {
 public:
     InteractiveCircleOfFifthsAudioProcessorEditor (InteractiveCircleOfFifthsAudioProcessor&);
@@ -229,11 +623,38 @@ public:
     void modeMenuChanged();
     void buttonClicked(juce::Button* button) override;
     bool keyPressed(const KeyPress& k) override;
+    bool isInterestedInFileDrag(const StringArray& files) override;
+    void filesDropped(const StringArray& files, int x, int y) override;
+    MemoryBudget::Usage getMemoryUsage() const;
+    void releaseMemory(MemoryBudget::Release what);
 private:
+    void timerCallback() override;
+    void pollHeldNotes();
+    void pollProgram();
+    void pollMidiRemote();
+    void applyProgram(const ProgramBank::Program& program);
+    void storeProgram();
+    void renameProgram();
+    void queueProgramModes();
     void setSeventhsButtonNextState();
+    void setTriadsAndSeventhsState(TriadsAndSeventhsState* state);
+    void setDoReMi(bool shouldShowDoReMi);
+    String getThemeName() const;
+    void selectThemeByName(const String& name);
     void updateModeMenuSelection(bool up);
     void updateConstrainer();
     void toggleHalfWidth();
+    void showThemeMenu();
+    void selectTheme(int index);
+    void showOptionsMenu();
+    void editProgression();
+    void editEdo();
+    void chordClicked(int degree);
+    void audition(const int* notes, int numNotes, float stepSeconds);
+    void auditionScale();
+    void updateVoiceLeading();
+    void updateComparison();
+    void layoutComparison(Rectangle<int> circleBounds);
 
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
@@ -244,12 +665,44 @@ private:
     TextButton seventhsButton;
     TextButton darkModeButton;
     TextButton halfWidthButton;
+    TextButton optionsButton;
+    CircleSettings circleSettings;
+    LayerCache layerCache;
     CircleComponent circleComponent;
+    std::vector<std::unique_ptr<CircleComponent>> comparisonCircles;
+    std::vector<std::pair<int, int>> comparedScales;
+    int comparison = 0;
+    int numComparisonCircles = 1;
+    TimelineComponent timelineComponent;
+    ScaleMatchList scaleMatchList;
+    uint32 heldNotesVersion = 0;
+    uint16 listedNotesMask = 0;
+    int listedBass = -1;
+    uint32 programVersion = 0;
+    std::vector<int> modesToWarm;   // of the stored programs, rendered one per timer tick
+    int warmedLayerSize = 0;
+    SharedResourcePointer<MemoryBudget> memoryBudget;
+    int selectedChordDegree = -1;
+    SharedResourcePointer<MidiFileAnalyser> midiFileAnalyser;
     TooltipWindow tooltipWindow{ this }; // instance required for ToolTips to work
     ComponentBoundsConstrainer constrainer;
 
     CustomLookAndFeel darkLookAndFeel;
     CustomLookAndFeel lightLookAndFeel;
+    CustomLookAndFeel themeLookAndFeel;
+    std::vector<Theme> themes;
+    std::optional<Theme> currentTheme;
+    // Held notes, program changes and the remote control are polled once per display frame rather than with the timer
+    VBlankAttachment heldNotesPoll{ this, [this]
+    {
+        ICOF_LATENCY_MARK(framePresented);
+        pollProgram();
+        pollMidiRemote();
+        pollHeldNotes();
+    } };
+#if ICOF_DIAGNOSTICS
+    std::unique_ptr<LatencyHarness> latencyHarness;
+#endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InteractiveCircleOfFifthsAudioProcessorEditor)
 };
@@ -31,6 +31,10 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+// Plugin instances in this process, for the memory report
+static juce::Array<InteractiveCircleOfFifthsAudioProcessor*> instances;
+static juce::CriticalSection instancesLock;
+
 //==============================================================================
 InteractiveCircleOfFifthsAudioProcessor::InteractiveCircleOfFifthsAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -44,10 +48,18 @@ InteractiveCircleOfFifthsAudioProcessor::InteractiveCircleOfFifthsAudioProcessor
                        )
 #endif
 {
+    // Builds the reverse lookup and modulation tables now rather than when the editor first needs them
+    scalesContaining (0);
+    findModulationRoute (0, 0);
+
+    const juce::ScopedLock lock (instancesLock);
+    instances.add (this);
 }
 
 InteractiveCircleOfFifthsAudioProcessor::~InteractiveCircleOfFifthsAudioProcessor()
 {
+    const juce::ScopedLock lock (instancesLock);
+    instances.removeFirstMatchingValue (this);
 }
 
 //==============================================================================
@@ -90,39 +102,49 @@ double InteractiveCircleOfFifthsAudioProcessor::getTailLengthSeconds() const
 
 int InteractiveCircleOfFifthsAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return ProgramBank::numPrograms;
 }
 
 int InteractiveCircleOfFifthsAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return programBank.getCurrent();
 }
 
 void InteractiveCircleOfFifthsAudioProcessor::setCurrentProgram (int index)
 {
+    // Any thread, program changes on the MIDI input come from the audio thread
+    if (index < 0 || index >= ProgramBank::numPrograms)
+        return;
+    rootNote = programBank.getRoot (index);
+    modeIndex = programBank.getMode (index);
+    chordLayer = programBank.getChordLayer (index);
+    programBank.select (index);
 }
 
 const juce::String InteractiveCircleOfFifthsAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return programBank.getProgram (index).name;
 }
 
 void InteractiveCircleOfFifthsAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    programBank.setName (index, newName);
 }
 
 //==============================================================================
 void InteractiveCircleOfFifthsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
+    chordSequencer.prepare (sampleRate);
+    scaleQuantiser.prepare();
+    heldNotes.reset();
+    transitionPlayer.prepare (sampleRate);
+    auditionSynth.prepare (sampleRate);
+    audioAnalyser.prepare (sampleRate);
 }
 
 void InteractiveCircleOfFifthsAudioProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    audioAnalyser.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -153,7 +175,26 @@ bool InteractiveCircleOfFifthsAudioProcessor::isBusesLayoutSupported (const Buse
 
 void InteractiveCircleOfFifthsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    // Let's do absolutely nothing here
+    // Audio passes through untouched
+    audioAnalyser.pushSamples (buffer, getTotalNumInputChannels());
+    midiRemote.process (midiMessages);
+    // Unless the remote control was given them, program changes select programs
+    if (! midiRemote.usesProgramChanges())
+    {
+        for (const juce::MidiMessageMetadata metadata : midiMessages)
+        {
+            if ((metadata.data[0] & 0xf0) == 0xc0 && metadata.numBytes >= 2)
+                setCurrentProgram (metadata.data[1]);
+        }
+    }
+    // Before the sequencer adds its own notes, and the circle shows the notes as snapped
+    scaleQuantiser.process (midiMessages, rootNote, modeIndex);
+    heldNotes.process (midiMessages);
+    chordSequencer.process (midiMessages, buffer.getNumSamples(), getPlayHead(),
+                            rootNote, modeIndex, chordLayer == ProgramBank::sevenths);
+    transitionPlayer.process (midiMessages, buffer.getNumSamples());
+    // Sounds everything on the way out, after the audio has been analysed
+    auditionSynth.process (buffer, midiMessages);
 }
 
 //==============================================================================
@@ -178,15 +219,142 @@ juce::AudioProcessorEditor* InteractiveCircleOfFifthsAudioProcessor::createEdito
 //==============================================================================
 void InteractiveCircleOfFifthsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    juce::XmlElement state ("STATE");
+    state.setAttribute ("root", rootNote.load());
+    state.setAttribute ("mode", modeIndex.load());
+    state.addChildElement (programBank.createXml().release());
+    juce::XmlElement* remote = state.createNewChildElement ("REMOTE");
+    for (int action = 0; action < MidiRemote::numActions; action++)
+        remote->setAttribute ("action" + juce::String (action), midiRemote.getBinding ((MidiRemote::Action) action));
+    copyXmlToBinary (state, destData);
 }
 
 void InteractiveCircleOfFifthsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    std::unique_ptr<juce::XmlElement> state = getXmlFromBinary (data, sizeInBytes);
+    if (state == nullptr || !state->hasTagName ("STATE"))
+        return;
+
+    if (juce::XmlElement* programs = state->getChildByName ("PROGRAMS"))
+        programBank.restoreFromXml (*programs);
+    setCurrentProgram (programBank.getCurrent());
+    if (juce::XmlElement* remote = state->getChildByName ("REMOTE"))
+    {
+        for (int action = 0; action < MidiRemote::numActions; action++)
+            midiRemote.setBinding ((MidiRemote::Action) action,
+                                   remote->getIntAttribute ("action" + juce::String (action), MidiRemote::unbound));
+    }
+    // The circle may have been turned since the program was selected
+    rootNote = pitchClass (state->getIntAttribute ("root", rootNote));
+    modeIndex = juce::jlimit (-1, numModes - 1, state->getIntAttribute ("mode", modeIndex));
+}
+
+//==============================================================================
+void InteractiveCircleOfFifthsAudioProcessor::updateTrackProperties (const TrackProperties& properties)
+{
+    // Hosts may call this from any thread, a transparent colour means "unknown"
+    trackColour = properties.colour.getARGB();
+}
+
+juce::Colour InteractiveCircleOfFifthsAudioProcessor::getTrackColour() const
+{
+    return juce::Colour (trackColour.load());
+}
+
+//==============================================================================
+void InteractiveCircleOfFifthsAudioProcessor::setRootNote (int pitchClass)
+{
+    rootNote = pitchClass;
+}
+
+int InteractiveCircleOfFifthsAudioProcessor::getRootNote() const
+{
+    return rootNote;
+}
+
+void InteractiveCircleOfFifthsAudioProcessor::setModeIndex (int newModeIndex)
+{
+    modeIndex = newModeIndex;
+}
+
+int InteractiveCircleOfFifthsAudioProcessor::getModeIndex() const
+{
+    return modeIndex;
+}
+
+void InteractiveCircleOfFifthsAudioProcessor::setChordLayer (int newChordLayer)
+{
+    chordLayer = newChordLayer;
+}
+
+int InteractiveCircleOfFifthsAudioProcessor::getChordLayer() const
+{
+    return chordLayer;
+}
+
+InteractiveCircleOfFifthsAudioProcessor::EditorSettings& InteractiveCircleOfFifthsAudioProcessor::getEditorSettings()
+{
+    return editorSettings;
+}
+
+ChordSequencer& InteractiveCircleOfFifthsAudioProcessor::getChordSequencer()
+{
+    return chordSequencer;
+}
+
+AudioAnalyser& InteractiveCircleOfFifthsAudioProcessor::getAudioAnalyser()
+{
+    return audioAnalyser;
+}
+
+const HeldNotes& InteractiveCircleOfFifthsAudioProcessor::getHeldNotes() const
+{
+    return heldNotes;
+}
+
+VoiceLeading& InteractiveCircleOfFifthsAudioProcessor::getVoiceLeading()
+{
+    return voiceLeading;
+}
+
+TransitionPlayer& InteractiveCircleOfFifthsAudioProcessor::getTransitionPlayer()
+{
+    return transitionPlayer;
+}
+
+AuditionSynth& InteractiveCircleOfFifthsAudioProcessor::getAuditionSynth()
+{
+    return auditionSynth;
+}
+
+ScaleQuantiser& InteractiveCircleOfFifthsAudioProcessor::getScaleQuantiser()
+{
+    return scaleQuantiser;
+}
+
+ProgramBank& InteractiveCircleOfFifthsAudioProcessor::getProgramBank()
+{
+    return programBank;
+}
+
+MidiRemote& InteractiveCircleOfFifthsAudioProcessor::getMidiRemote()
+{
+    return midiRemote;
+}
+
+size_t InteractiveCircleOfFifthsAudioProcessor::getMemoryBytes() const
+{
+    return sizeof (*this) + audioAnalyser.getMemoryBytes();
+}
+
+size_t InteractiveCircleOfFifthsAudioProcessor::getTotalMemoryBytes (int& numInstances)
+{
+    const juce::ScopedLock lock (instancesLock);
+    size_t bytes = 0;
+    for (InteractiveCircleOfFifthsAudioProcessor* instance : instances)
+        bytes += instance->getMemoryBytes();
+    numInstances = instances.size();
+    return bytes;
 }
 
 //==============================================================================
@@ -31,6 +31,15 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "ChordSequencer.h"
+#include "AudioAnalyser.h"
+#include "HeldNotes.h"
+#include "VoiceLeading.h"
+#include "TransitionPlayer.h"
+#include "AuditionSynth.h"
+#include "ScaleQuantiser.h"
+#include "ProgramBank.h"
+#include "MidiRemote.h"
 
 //==============================================================================
 /**
@@ -75,7 +84,62 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    //==============================================================================
+    void updateTrackProperties (const TrackProperties& properties) override;
+    juce::Colour getTrackColour() const;
+
+    //==============================================================================
+    // What the circle shows. Written by the editor, read from the audio thread.
+    void setRootNote (int pitchClass);
+    int getRootNote() const;
+    void setModeIndex (int modeIndex);  // -1 when only the notes are shown
+    int getModeIndex() const;
+    void setChordLayer (int chordLayer);  // a ProgramBank::ChordLayer
+    int getChordLayer() const;
+
+    // Message thread. How the editor looked when it was closed, the program bank version included
+    // so that a program changed meanwhile is applied when it opens again.
+    struct EditorSettings
+    {
+        bool doReMi = false;
+        juce::String theme { "Light" };
+        juce::uint32 programVersion = ~0u;
+    };
+    EditorSettings& getEditorSettings();
+
+    ChordSequencer& getChordSequencer();
+    AudioAnalyser& getAudioAnalyser();
+    const HeldNotes& getHeldNotes() const;
+    VoiceLeading& getVoiceLeading();
+    TransitionPlayer& getTransitionPlayer();
+    AuditionSynth& getAuditionSynth();
+    ScaleQuantiser& getScaleQuantiser();
+    ProgramBank& getProgramBank();
+    MidiRemote& getMidiRemote();
+
+    //==============================================================================
+    // Message thread. The tables live inside the processor, the analyser's buffers on the heap.
+    size_t getMemoryBytes() const;
+    // Every processor in this process
+    static size_t getTotalMemoryBytes (int& numInstances);
+
 private:
     //==============================================================================
+    std::atomic<juce::uint32> trackColour { 0 };
+    std::atomic<int> rootNote { 0 };
+    std::atomic<int> modeIndex { -1 };
+    std::atomic<int> chordLayer { ProgramBank::noChords };
+    EditorSettings editorSettings;
+
+    ChordSequencer chordSequencer;
+    AudioAnalyser audioAnalyser;
+    HeldNotes heldNotes;
+    VoiceLeading voiceLeading;
+    TransitionPlayer transitionPlayer;
+    AuditionSynth auditionSynth;
+    ScaleQuantiser scaleQuantiser;
+    ProgramBank programBank;
+    MidiRemote midiRemote;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InteractiveCircleOfFifthsAudioProcessor)
 };
\ No newline at end of file
@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "ProgramBank.h"
+
+ProgramBank::ProgramBank()
+{
+    for (int idx = 0; idx < numPrograms; idx++)
+    {
+        programs[idx].name = "Program " + juce::String(idx + 1);
+        programs[idx].theme = "Light";
+        packed[idx] = pack(programs[idx]);
+    }
+}
+
+int ProgramBank::pack(const Program& program)
+{
+    return pitchClass(program.root) | (program.mode + 1) << 4 | program.chordLayer << 8;
+}
+
+ProgramBank::Program ProgramBank::getProgram(int index) const
+{
+    return programs[juce::jlimit(0, numPrograms - 1, index)];
+}
+
+void ProgramBank::setProgram(int index, const Program& program)
+{
+    if (index < 0 || index >= numPrograms)
+        return;
+    programs[index] = program;
+    packed[index] = pack(program);
+}
+
+void ProgramBank::setName(int index, const juce::String& name)
+{
+    if (index >= 0 && index < numPrograms)
+        programs[index].name = name;
+}
+
+std::unique_ptr<juce::XmlElement> ProgramBank::createXml() const
+{
+    auto xml = std::make_unique<juce::XmlElement>("PROGRAMS");
+    xml->setAttribute("current", getCurrent());
+    for (const Program& program : programs)
+    {
+        juce::XmlElement* element = xml->createNewChildElement("PROGRAM");
+        element->setAttribute("name", program.name);
+        element->setAttribute("root", program.root);
+        element->setAttribute("mode", program.mode);
+        element->setAttribute("chords", program.chordLayer);
+        element->setAttribute("doReMi", program.doReMi);
+        element->setAttribute("theme", program.theme);
+    }
+    return xml;
+}
+
+void ProgramBank::restoreFromXml(const juce::XmlElement& xml)
+{
+    int index = 0;
+    for (juce::XmlElement* element : xml.getChildWithTagNameIterator("PROGRAM"))
+    {
+        if (index == numPrograms)
+            break;
+        Program program;
+        program.name = element->getStringAttribute("name", "Program " + juce::String(index + 1));
+        program.root = pitchClass(element->getIntAttribute("root"));
+        program.mode = juce::jlimit(-1, numModes - 1, element->getIntAttribute("mode", -1));
+        program.chordLayer = juce::jlimit((int)noChords, (int)sevenths, element->getIntAttribute("chords", noChords));
+        program.doReMi = element->getBoolAttribute("doReMi");
+        program.theme = element->getStringAttribute("theme", "Light");
+        setProgram(index++, program);
+    }
+    current = juce::jlimit(0, numPrograms - 1, xml.getIntAttribute("current"));
+}
+
+void ProgramBank::select(int index)
+{
+    current = juce::jlimit(0, numPrograms - 1, index);
+    version++;
+}
+
+int ProgramBank::getCurrent() const
+{
+    return current;
+}
+
+juce::uint32 ProgramBank::getVersion() const
+{
+    return version;
+}
+
+int ProgramBank::getRoot(int index) const
+{
+    return packed[juce::jlimit(0, numPrograms - 1, index)] & 0xf;
+}
+
+int ProgramBank::getMode(int index) const
+{
+    return ((packed[juce::jlimit(0, numPrograms - 1, index)] >> 4) & 0xf) - 1;
+}
+
+ProgramBank::ChordLayer ProgramBank::getChordLayer(int index) const
+{
+    return (ChordLayer)((packed[juce::jlimit(0, numPrograms - 1, index)] >> 8) & 0x3);
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// Named snapshots of the circle, switched by the host's program changes.
+//
+// The root, mode and chord layer of every program are packed into one atomic
+// each, so a program change on the audio thread takes effect in the same block
+// without locking. The editor notices the new program from the version, and
+// brings the names, notation and theme along with it.
+class ProgramBank
+{
+public:
+    static constexpr int numPrograms = 16;
+
+    enum ChordLayer { noChords, triads, sevenths };
+
+    struct Program
+    {
+        juce::String name;
+        int root = 0;
+        int mode = -1;          // -1 when only the notes are shown
+        int chordLayer = noChords;
+        bool doReMi = false;
+        juce::String theme;     // "Light", "Dark" or the name of a theme
+    };
+
+    ProgramBank();
+
+    // Message thread
+    Program getProgram(int index) const;
+    void setProgram(int index, const Program& program);
+    void setName(int index, const juce::String& name);
+    std::unique_ptr<juce::XmlElement> createXml() const;
+    void restoreFromXml(const juce::XmlElement& xml);
+
+    // Any thread
+    void select(int index);
+    int getCurrent() const;
+    juce::uint32 getVersion() const;    // changes with every select()
+    int getRoot(int index) const;
+    int getMode(int index) const;
+    ChordLayer getChordLayer(int index) const;
+
+private:
+    static int pack(const Program& program);
+
+    Program programs[numPrograms];
+    std::atomic<int> packed[numPrograms];   // root | (mode + 1) << 4 | chord layer << 8
+    std::atomic<int> current{ 0 };
+    std::atomic<juce::uint32> version{ 0 };
+};
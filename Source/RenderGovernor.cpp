@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "PluginEditor.h"
+
+//Machine specific settings, next to Themes.xml:
+//<SETTINGS frameBudgetMs="8" memoryBudgetMb="0"/>
+File RenderGovernor::getSettingsFile()
+{
+    return File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("InteractiveCircleOfFifths")
+        .getChildFile("Settings.xml");
+}
+
+RenderGovernor::RenderGovernor()
+{
+    std::unique_ptr<XmlElement> xml = XmlDocument::parse(getSettingsFile());
+    if (xml != nullptr && xml->hasTagName("SETTINGS"))
+        budgetMs = jlimit(1.0, 100.0, xml->getDoubleAttribute("frameBudgetMs", budgetMs));
+}
+
+void RenderGovernor::setBudgetMs(double newBudgetMs)
+{
+    budgetMs = newBudgetMs;
+    level = fullQuality;
+
+    //Other settings may be added by hand, so only this attribute is touched
+    File file = getSettingsFile();
+    std::unique_ptr<XmlElement> xml = XmlDocument::parse(file);
+    if (xml == nullptr || !xml->hasTagName("SETTINGS"))
+        xml = std::make_unique<XmlElement>("SETTINGS");
+    xml->setAttribute("frameBudgetMs", budgetMs);
+    file.getParentDirectory().createDirectory();
+    xml->writeTo(file);
+}
+
+void RenderGovernor::frameFinished(double milliseconds, bool inMotion)
+{
+    uint32 now = Time::getMillisecondCounter();
+    averageMs = numFrames == 0 ? milliseconds : averageMs * 0.8 + milliseconds * 0.2;
+    worstMs = jmax(milliseconds, worstMs * 0.99);
+    numFrames++;
+    if (milliseconds > budgetMs)
+    {
+        numFramesOverBudget++;
+        lastOverBudgetMs = now;
+    }
+
+    //Only frames in motion count, settling frames are full quality on purpose and render new rasters.
+    //Each level gets a few frames to show its effect before the next one is tried.
+    if (inMotion && averageMs > budgetMs && level < numLevels - 1 && now - lastLevelChangeMs > levelChangeIntervalMs)
+    {
+        level = (Level)(level + 1);
+        lastLevelChangeMs = now;
+        numLevelChanges++;
+        DBG("Render quality down to " << getLevelName(level) << ", " << String(averageMs, 1) << " ms against " << budgetMs << " ms");
+    }
+}
+
+void RenderGovernor::idle()
+{
+    //One level back up per quiet spell, all of them if nothing has been over budget for a while
+    if (level == fullQuality)
+        return;
+    uint32 now = Time::getMillisecondCounter();
+    level = now - lastOverBudgetMs > recoveryMs ? fullQuality : (Level)(level - 1);
+    lastLevelChangeMs = now;
+    numLevelChanges++;
+    DBG("Render quality up to " << getLevelName(level));
+}
+
+String RenderGovernor::getStatsText() const
+{
+    String text;
+    text << getLevelName(level) << ", " << String(averageMs, 1) << " ms (worst " << String(worstMs, 1)
+        << ") of " << budgetMs << " ms, " << numFramesOverBudget << "/" << numFrames << " over, "
+        << numLevelChanges << " changes";
+    return text;
+}
+
+const char* RenderGovernor::getLevelName(Level level)
+{
+    switch (level)
+    {
+    case fullQuality: return "Full quality";
+    case cachedLayers: return "Cached layers";
+    case nearestNeighbour: return "No smoothing";
+    case noSevenths: return "No sevenths";
+    default: return "";
+    }
+}
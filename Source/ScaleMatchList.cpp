@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "PluginEditor.h"
+
+void ScaleMatchList::setHeldNotes(uint16 mask, int bass)
+{
+    matches.clear();
+    setHoverRow(-1);
+    heading = {};
+    if (mask == 0)
+    {
+        repaint();
+        return;
+    }
+
+    ChordMatch chord = chordFromMask(mask);
+    if (chord.root >= 0)
+        heading = String(noteNames[chord.root]) + chordSuffixes[chord.type];
+    else
+    {
+        for (int pc = 0; pc < 12; pc++)
+        {
+            if (mask & (1 << pc))
+                heading << noteNames[pc] << " ";
+        }
+    }
+
+    //The lookup is a single table read, ranking the handful of scales it finds is all the work left
+    const ScaleSet& scales = scalesContaining(mask);
+    for (int scale = 0; scale < numScales; scale++)
+    {
+        if (!scales.contains(scale))
+            continue;
+        int root = scale % 12;
+        int mode = scale / 12;
+        int score = (root == bass ? 8 : 0)
+            + ((mask >> root) & 1) * 4
+            + ((mask >> pitchClass(root + modeIntervals[mode][4])) & 1) * 2
+            + (mode == 0 || mode == 5 ? 1 : 0);     // major and natural minor are the likelier readings
+        matches.push_back({ root, mode, score });
+    }
+    std::stable_sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.score > b.score; });
+    if ((int)matches.size() > maxRows)
+        matches.resize(maxRows);
+    repaint();
+}
+
+int ScaleMatchList::getIdealHeight(int rowHeight) const
+{
+    return rowHeight * (1 + jmax(1, (int)matches.size()));
+}
+
+int ScaleMatchList::rowAt(float y) const
+{
+    int rowHeight = getHeight() / (1 + jmax(1, (int)matches.size()));
+    int row = rowHeight > 0 ? (int)y / rowHeight - 1 : -1;
+    return row >= 0 && row < (int)matches.size() ? row : -1;
+}
+
+void ScaleMatchList::paint(Graphics& g)
+{
+    if (isEmpty())
+        return;
+
+    Colour ink = getLookAndFeel().findColour(TextButton::textColourOnId);
+    Colour paper = getLookAndFeel().findColour(TextButton::buttonColourId);
+    int numRows = 1 + jmax(1, (int)matches.size());
+    int rowHeight = getHeight() / numRows;
+    g.setColour(paper.withAlpha(0.9f));
+    g.fillRect(getLocalBounds());
+    g.setColour(ink);
+    g.drawRect(getLocalBounds());
+
+    Rectangle<int> row = getLocalBounds().reduced(rowHeight / 4, 0).removeFromTop(rowHeight);
+    g.setFont(Font(rowHeight * 0.7f, Font::bold));
+    g.drawText(heading, row, Justification::centredLeft);
+
+    g.setFont(rowHeight * 0.65f);
+    if (matches.empty())
+        g.drawText("Not in any scale", row.translated(0, rowHeight), Justification::centredLeft);
+    for (int idx = 0; idx < (int)matches.size(); idx++)
+    {
+        row.translate(0, rowHeight);
+        if (idx == hoverRow)
+        {
+            g.setColour(getLookAndFeel().findColour(TextButton::buttonOnColourId));
+            g.fillRect(row.withX(0).withWidth(getWidth()));
+            g.setColour(ink);
+        }
+        g.drawText(String(noteNames[matches[idx].root]) + " " + modes[matches[idx].mode + 1], row, Justification::centredLeft);
+    }
+}
+
+void ScaleMatchList::mouseMove(const MouseEvent& event)
+{
+    setHoverRow(rowAt(event.position.y));
+}
+
+void ScaleMatchList::mouseExit(const MouseEvent&)
+{
+    setHoverRow(-1);
+}
+
+void ScaleMatchList::setHoverRow(int row)
+{
+    if (row == hoverRow)
+        return;
+    hoverRow = row;
+    repaint();
+    if (onScaleHovered)
+        onScaleHovered(row >= 0 ? matches[row].root : -1, row >= 0 ? matches[row].mode : -1);
+}
+
+void ScaleMatchList::mouseDown(const MouseEvent& event)
+{
+    int row = rowAt(event.position.y);
+    if (row >= 0 && onScaleSelected)
+        onScaleSelected(matches[row].root, matches[row].mode);
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#include "ScaleQuantiser.h"
+
+ScaleQuantiser::ScaleQuantiser()
+{
+    for (int mode = 0; mode < numModes; mode++)
+    {
+        for (int root = 0; root < 12; root++)
+        {
+            juce::uint16 mask = scaleMask(root, mode);
+            auto inScale = [mask](int note) { return note >= 0 && note < 128 && (mask & (1 << pitchClass(note))) != 0; };
+            for (int note = 0; note < 128; note++)
+            {
+                //Past either end of the note range there is only one way to go
+                int below = note, above = note;
+                while (!inScale(below) && below > note - 12)
+                    below--;
+                while (!inScale(above) && above < note + 12)
+                    above++;
+                if (!inScale(below))
+                    below = above;
+                if (!inScale(above))
+                    above = below;
+
+                //Ties go down
+                tables[nearest - 1][mode][root][note] = (juce::int8)(above - note < note - below ? above : below);
+                tables[up - 1][mode][root][note] = (juce::int8)above;
+                tables[down - 1][mode][root][note] = (juce::int8)below;
+                tables[filter - 1][mode][root][note] = inScale(note) ? (juce::int8)note : dropped;
+            }
+        }
+    }
+    for (auto& channel : heldAs)
+        std::fill(std::begin(channel), std::end(channel), notHeld);
+}
+
+void ScaleQuantiser::setSnap(Snap newSnap)
+{
+    snap = newSnap;
+}
+
+ScaleQuantiser::Snap ScaleQuantiser::getSnap() const
+{
+    return snap;
+}
+
+juce::uint16 ScaleQuantiser::getSnappedNotes() const
+{
+    return snappedNotes;
+}
+
+void ScaleQuantiser::prepare()
+{
+    //Enough for any block a host is likely to send, so that process() never has to grow it
+    output.ensureSize(4096);
+}
+
+void ScaleQuantiser::process(juce::MidiBuffer& midi, int root, int mode)
+{
+    //Picked once, so the whole block is snapped to the same scale
+    Snap currentSnap = snap;
+    bool active = currentSnap != off && mode >= 0 && mode < numModes;
+    const juce::int8* current = active ? tables[currentSnap - 1][mode][pitchClass(root)] : nullptr;
+    //Notes held from before snapping was turned off still end on the note they were sent as
+    if (current == nullptr && numHeld == 0)
+        return;
+
+    output.clear();
+    for (const juce::MidiMessageMetadata metadata : midi)
+    {
+        const juce::uint8* data = metadata.data;
+        int status = data[0] & 0xf0;
+        int channel = data[0] & 0x0f;
+        if ((status != 0x80 && status != 0x90) || metadata.numBytes < 3)
+        {
+            //All notes off and all sound off end whatever the channel has held
+            if (status == 0xb0 && metadata.numBytes >= 3 && (data[1] == 120 || data[1] == 123))
+            {
+                for (int note = 0; note < 128; note++)
+                {
+                    if (heldAs[channel][note] != notHeld)
+                        noteOff(channel, note);
+                }
+            }
+            output.addEvent(data, metadata.numBytes, metadata.samplePosition);
+            continue;
+        }
+
+        int note = data[1] & 0x7f;
+        int sendAs = status == 0x90 && data[2] != 0 ? noteOn(channel, note, current) : noteOff(channel, note);
+        if (sendAs >= 0)
+        {
+            juce::uint8 bytes[3] { data[0], (juce::uint8)sendAs, data[2] };
+            output.addEvent(bytes, 3, metadata.samplePosition);
+        }
+    }
+    midi.swapWith(output);
+    snappedNotes = snappedMask;
+}
+
+int ScaleQuantiser::noteOn(int channel, int note, const juce::int8* current)
+{
+    juce::int8& sent = heldAs[channel][note];
+    if (sent != notHeld)
+        return -1;  // a repeat would muddle which note-off ends what
+    sent = current != nullptr ? current[note] : (juce::int8)note;
+    numHeld++;
+    if (sent == dropped)
+        return -1;
+
+    if (sent != note && snappedCounts[pitchClass(sent)]++ == 0)
+        snappedMask |= (juce::uint16)(1 << pitchClass(sent));
+    return outputCounts[channel][sent]++ == 0 ? sent : -1;
+}
+
+int ScaleQuantiser::noteOff(int channel, int note)
+{
+    juce::int8 sent = heldAs[channel][note];
+    if (sent == notHeld)
+        return note;    // from before snapping was turned on
+    heldAs[channel][note] = notHeld;
+    numHeld--;
+    if (sent == dropped)
+        return -1;
+
+    if (sent != note && --snappedCounts[pitchClass(sent)] == 0)
+        snappedMask &= (juce::uint16)~(1 << pitchClass(sent));
+    return --outputCounts[channel][sent] == 0 ? sent : -1;
+}
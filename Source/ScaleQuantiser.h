@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// Snaps the notes on the MIDI input to the selected root and mode.
+//
+// A 128 note table for every root, mode and snap direction is built up front,
+// and process() picks one per block from the scale it is given, so each note
+// costs one table read and a program change can switch scales mid-stream.
+// Note-offs go to whatever note their note-on was snapped to, however the
+// scale changed in between.
+class ScaleQuantiser
+{
+public:
+    enum Snap { off, nearest, up, down, filter, numSnaps };
+
+    ScaleQuantiser();
+
+    // Any thread
+    void setSnap(Snap newSnap);
+    Snap getSnap() const;
+
+    // Audio thread. Mode -1 lets every note through.
+    void prepare();
+    void process(juce::MidiBuffer& midi, int root, int mode);
+
+    // Any thread. Pitch classes of the notes held that were snapped to another note.
+    juce::uint16 getSnappedNotes() const;
+
+private:
+    // Both return the note to send, or -1 for none
+    int noteOn(int channel, int note, const juce::int8* current);
+    int noteOff(int channel, int note);
+
+    static constexpr juce::int8 dropped = -1;
+    static constexpr juce::int8 notHeld = -2;
+
+    // [snap - 1][mode][root][note], the output note or dropped
+    juce::int8 tables[numSnaps - 1][numModes][12][128];
+
+    std::atomic<Snap> snap{ off };
+
+    juce::MidiBuffer output;
+    juce::int8 heldAs[16][128];             // [channel][input note] the note sent for it
+    juce::uint8 outputCounts[16][128] = {}; // input notes snapped to the same one share it
+    int numHeld = 0;
+    int snappedCounts[12] = {};
+    juce::uint16 snappedMask = 0;
+    std::atomic<juce::uint16> snappedNotes{ 0 };
+};
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "SkinPack.h"
+
+std::unique_ptr<SkinPack> SkinPack::open(const juce::File& file)
+{
+    std::unique_ptr<SkinPack> pack(new SkinPack());
+    pack->file = file;
+    //A copy rather than a mapping, a pack truncated while it is being saved over must not take the host down
+    if (!file.loadFileAsData(pack->data) || pack->data.getSize() == 0)
+        return nullptr;
+
+    pack->zipFile = std::make_unique<juce::ZipFile>(new juce::MemoryInputStream(pack->data, false), true);
+    for (int idx = 0; idx < pack->zipFile->getNumEntries(); idx++)
+    {
+        juce::String name = pack->zipFile->getEntry(idx)->filename.fromLastOccurrenceOf("/", false, false);
+        if (name.endsWithIgnoreCase(".svg"))
+            pack->entryIndices[name.toLowerCase()] = idx;
+    }
+    if (pack->entryIndices.empty())
+        return nullptr;
+    return pack;
+}
+
+juce::File SkinPack::getSkinsDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("InteractiveCircleOfFifths")
+        .getChildFile("Skins");
+}
+
+int SkinPack::indexOf(const juce::String& fileName) const
+{
+    auto found = entryIndices.find(fileName.toLowerCase());
+    return found != entryIndices.end() ? found->second : -1;
+}
+
+bool SkinPack::hasEntry(const juce::String& fileName) const
+{
+    return indexOf(fileName) >= 0;
+}
+
+juce::String SkinPack::getEntrySignature(const juce::String& fileName) const
+{
+    int index = indexOf(fileName);
+    if (index < 0)
+        return {};
+    const juce::ZipFile::ZipEntry* entry = zipFile->getEntry(index);
+    return file.getFullPathName() + "|" + entry->filename + "|" + juce::String(entry->uncompressedSize)
+        + "|" + juce::String(entry->fileTime.toMilliseconds());
+}
+
+std::unique_ptr<juce::Drawable> SkinPack::createDrawable(const juce::String& fileName) const
+{
+    int index = indexOf(fileName);
+    if (index < 0)
+        return nullptr;
+
+    //ZipFile serialises reads of the underlying stream, so entries can be inflated from any thread
+    std::unique_ptr<juce::InputStream> stream(zipFile->createStreamForEntry(index));
+    if (stream == nullptr)
+        return nullptr;
+    juce::MemoryBlock data;
+    stream->readIntoMemoryBlock(data);
+    return juce::Drawable::createFromImageData(data.getData(), data.getSize());
+}
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// Artwork from outside the plugin binary: a zip file of SVGs named like the
+// built-in ones, e.g. LM_Ionian.svg or DM_Modes_Triads.svg. Folders inside
+// the zip are ignored, and any artwork left out falls back to the built-in one.
+//
+// The file is read into memory when the pack is opened, packs are small and
+// may be saved over while open. An entry is only inflated and parsed when it
+// is asked for.
+class SkinPack
+{
+public:
+    // nullptr if the file can't be read or isn't a zip
+    static std::unique_ptr<SkinPack> open(const juce::File& file);
+
+    bool hasEntry(const juce::String& fileName) const;
+    // Changes whenever the entry does, empty if there is no such entry
+    juce::String getEntrySignature(const juce::String& fileName) const;
+    // Any thread
+    std::unique_ptr<juce::Drawable> createDrawable(const juce::String& fileName) const;
+    size_t getMemoryBytes() const { return data.getSize(); }
+
+    // Where skin packs are looked for
+    static juce::File getSkinsDirectory();
+
+private:
+    SkinPack() = default;
+    int indexOf(const juce::String& fileName) const;
+
+    juce::File file;
+    juce::MemoryBlock data;
+    std::unique_ptr<juce::ZipFile> zipFile;
+    std::map<juce::String, int> entryIndices;   // by lower case file name
+};
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "PluginEditor.h"
+
+//User themes are read from e.g. %APPDATA%\InteractiveCircleOfFifths\Themes.xml:
+//<THEMES>
+//  <THEME name="Solarized" ink="ff073642" paper="fffdf6e3"/>
+//</THEMES>
+static File getUserThemesFile()
+{
+    return File::getSpecialLocation(File::userApplicationDataDirectory)
+        .getChildFile("InteractiveCircleOfFifths")
+        .getChildFile("Themes.xml");
+}
+
+std::vector<Theme> loadThemes(Colour trackColour)
+{
+    std::vector<Theme> themes {
+        { "High contrast", Colours::white, Colours::black },
+        { "Colour-blind safe", Colour(0, 62, 125), Colour(255, 244, 222) }
+    };
+
+    //Track colour is only known when the host reports it
+    if (!trackColour.isTransparent())
+        themes.push_back({ "Track colour", trackColour.withBrightness(0.2f), trackColour.withSaturation(0.2f).withBrightness(0.97f) });
+
+    std::unique_ptr<XmlElement> xml = XmlDocument::parse(getUserThemesFile());
+    if (xml != nullptr && xml->hasTagName("THEMES"))
+    {
+        for (auto* element : xml->getChildWithTagNameIterator("THEME"))
+        {
+            String name = element->getStringAttribute("name");
+            if (name.isNotEmpty())
+            {
+                themes.push_back({ name,
+                    Colour::fromString(element->getStringAttribute("ink", "ff000000")),
+                    Colour::fromString(element->getStringAttribute("paper", "ffffffff")) });
+            }
+        }
+    }
+    return themes;
+}
+
+void applyTheme(Image& image, const Theme& theme)
+{
+    //Pixels are premultiplied, with a luma of 0..alpha. That makes the ramp linear:
+    //  out = (alpha - luma) * ink + luma * paper
+    //so the loop has no branches, lookups or divisions and the compiler can vectorise it.
+    Image::BitmapData data(image, Image::BitmapData::readWrite);
+    jassert(data.pixelFormat == Image::ARGB && data.pixelStride == 4);
+
+    const uint32 inkR = theme.ink.getRed(), inkG = theme.ink.getGreen(), inkB = theme.ink.getBlue();
+    const uint32 paperR = theme.paper.getRed(), paperG = theme.paper.getGreen(), paperB = theme.paper.getBlue();
+
+    for (int y = 0; y < data.height; ++y)
+    {
+        uint32* line = (uint32*)data.getLinePointer(y);
+        for (int x = 0; x < data.width; ++x)
+        {
+            const uint32 pixel = line[x];
+            const uint32 a = pixel >> 24;
+            const uint32 luma = (((pixel >> 16) & 0xff) * 77 + ((pixel >> 8) & 0xff) * 150 + (pixel & 0xff) * 29) >> 8;
+            const uint32 shade = a - jmin(luma, a);
+
+            //x / 255 for x < 65536, without the division
+            const uint32 r = shade * inkR + luma * paperR + 128;
+            const uint32 g = shade * inkG + luma * paperG + 128;
+            const uint32 b = shade * inkB + luma * paperB + 128;
+            line[x] = (a << 24)
+                | (((r + (r >> 8)) >> 8) << 16)
+                | (((g + (g >> 8)) >> 8) << 8)
+                | ((b + (b >> 8)) >> 8);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "PluginEditor.h"
+
+//One hue per mode, light enough for black labels and the dark mode foreground alike
+static Colour modeColour(int mode)
+{
+    if (mode < 0)
+        return Colours::transparentBlack;
+    return Colour::fromHSV((float)mode / numModes, 0.35f, 0.85f, 1.0f);
+}
+
+void TimelineComponent::setTimeline(std::shared_ptr<const KeyTimeline> newTimeline)
+{
+    timeline = newTimeline;
+    position = -1;
+    selectedSegment = nullptr;
+    if (timeline != nullptr)
+        setTooltip(timeline->fileName + " - analysed in " + String(roundToInt(timeline->analysisSeconds * 1000))
+            + " ms. Click or drag to follow the keys, right-click to close.");
+    repaint();
+}
+
+void TimelineComponent::paint(Graphics& g)
+{
+    if (timeline == nullptr || timeline->length <= 0)
+        return;
+
+    Rectangle<float> bounds = getLocalBounds().toFloat();
+    float pixelsPerSecond = bounds.getWidth() / (float)timeline->length;
+    Colour ink = getLookAndFeel().findColour(TextButton::textColourOnId);
+    g.setFont(bounds.getHeight() * 0.6f);
+
+    for (const KeyTimeline::Segment& segment : timeline->segments)
+    {
+        Rectangle<float> area(bounds.getX() + (float)segment.start * pixelsPerSecond, bounds.getY(),
+            (float)(segment.end - segment.start) * pixelsPerSecond, bounds.getHeight());
+        g.setColour(modeColour(segment.mode));
+        g.fillRect(area);
+        if (segment.root >= 0 && &segment == selectedSegment)
+        {
+            g.setColour(ink);
+            g.drawRect(area, 2.0f);
+        }
+        //Only label segments with room for it, scrubbing shows the rest on the circle
+        if (segment.root >= 0 && area.getWidth() > bounds.getHeight() * 1.2f)
+        {
+            g.setColour(Colours::black);
+            g.drawText(noteNames[segment.root], area, Justification::centred, false);
+        }
+    }
+
+    g.setColour(ink);
+    g.drawRect(bounds, 1.0f);
+    if (position >= 0)
+        g.fillRect(bounds.getX() + (float)position * pixelsPerSecond - 1.0f, bounds.getY(), 2.0f, bounds.getHeight());
+}
+
+void TimelineComponent::mouseDown(const MouseEvent& event)
+{
+    if (event.mods.isPopupMenu())
+    {
+        setTimeline(nullptr);
+        if (onCleared)
+            onCleared();
+        return;
+    }
+    scrubTo(event.position.x);
+}
+
+void TimelineComponent::mouseDrag(const MouseEvent& event)
+{
+    if (!event.mods.isPopupMenu())
+        scrubTo(event.position.x);
+}
+
+void TimelineComponent::scrubTo(float x)
+{
+    if (timeline == nullptr || getWidth() <= 0)
+        return;
+
+    position = jlimit(0.0, timeline->length, (double)x / getWidth() * timeline->length);
+    const KeyTimeline::Segment* segment = timeline->getSegmentAt(position);
+    //Only tell when the segment changes, dragging through one keeps the circle still
+    if (segment != selectedSegment && segment != nullptr && segment->root >= 0 && onSegmentSelected)
+        onSegmentSelected(*segment);
+    selectedSegment = segment;
+    repaint();
+}
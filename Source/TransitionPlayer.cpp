@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "TransitionPlayer.h"
+
+void TransitionPlayer::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+}
+
+bool TransitionPlayer::isEnabled() const
+{
+    return enabled;
+}
+
+bool TransitionPlayer::play(const Transition& transition)
+{
+    return enabled && queue.push(transition);
+}
+
+void TransitionPlayer::prepare(double sampleRate)
+{
+    chordSamples = juce::jmax(1, juce::roundToInt(sampleRate * chordSeconds));
+}
+
+void TransitionPlayer::process(juce::MidiBuffer& midi, int numSamples)
+{
+    //Queued transitions play one after the other, each event at its exact sample
+    int sample = 0;
+    while (true)
+    {
+        if (stage < 0)
+        {
+            if (!queue.pop(current))
+                return;
+            notesOn(midi, current.from, current.numFrom, sample);
+            stage = 0;
+            samplesLeft = chordSamples;
+        }
+
+        if (samplesLeft >= numSamples - sample)
+        {
+            samplesLeft -= numSamples - sample;
+            return;
+        }
+        sample += samplesLeft;
+
+        notesOff(midi, stage == 0 ? current.from : current.to, stage == 0 ? current.numFrom : current.numTo, sample);
+        if (stage == 0)
+        {
+            notesOn(midi, current.to, current.numTo, sample);
+            stage = 1;
+            samplesLeft = chordSamples;
+        }
+        else
+            stage = -1;
+    }
+}
+
+void TransitionPlayer::notesOn(juce::MidiBuffer& midi, const juce::int8* notes, int numNotes, int sampleOffset)
+{
+    for (int idx = 0; idx < numNotes; idx++)
+        midi.addEvent(juce::MidiMessage::noteOn(midiChannel, notes[idx], (juce::uint8)90), sampleOffset);
+}
+
+void TransitionPlayer::notesOff(juce::MidiBuffer& midi, const juce::int8* notes, int numNotes, int sampleOffset)
+{
+    for (int idx = 0; idx < numNotes; idx++)
+        midi.addEvent(juce::MidiMessage::noteOff(midiChannel, notes[idx]), sampleOffset);
+}
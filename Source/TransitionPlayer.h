@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "LockFreeQueue.h"
+
+//==============================================================================
+// Plays a chord followed by another on the MIDI output, e.g. to hear the
+// smoothest voice leading between two chords picked on the circle.
+//
+// The editor queues transitions through a LockFreeQueue, so nothing on the
+// audio thread waits for it.
+class TransitionPlayer
+{
+public:
+    struct Transition
+    {
+        juce::int8 from[4];
+        juce::int8 numFrom;
+        juce::int8 to[4];
+        juce::int8 numTo;
+    };
+
+    // Message thread
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+    bool play(const Transition& transition);
+
+    // Audio thread
+    void prepare(double sampleRate);
+    void process(juce::MidiBuffer& midi, int numSamples);
+
+private:
+    void notesOn(juce::MidiBuffer& midi, const juce::int8* notes, int numNotes, int sampleOffset);
+    void notesOff(juce::MidiBuffer& midi, const juce::int8* notes, int numNotes, int sampleOffset);
+
+    std::atomic<bool> enabled{ false };
+    LockFreeQueue<Transition, 16> queue;
+
+    Transition current{};
+    int stage = -1;     // -1 idle, 0 playing the first chord, 1 the second
+    int samplesLeft = 0;
+    int chordSamples = 44100;
+
+    static constexpr int midiChannel = 1;
+    static constexpr double chordSeconds = 0.8;
+};
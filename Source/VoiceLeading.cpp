@@ -0,0 +1,160 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#include "VoiceLeading.h"
+#include "Diagnostics.h"
+
+VoiceLeading::VoiceLeading()
+{
+}
+
+VoiceLeading::~VoiceLeading()
+{
+    //Jobs use this object, so a running one is waited for however long it takes
+    pool.removeAllJobs(true, -1);
+}
+
+void VoiceLeading::setRange(int newLowestNote, int newHighestNote)
+{
+    //At least an octave, so that every chord has a voicing
+    lowestNote = juce::jlimit(0, 115, newLowestNote);
+    highestNote = juce::jlimit(lowestNote + 12, 127, newHighestNote);
+}
+
+std::shared_ptr<const VoiceLeadingTable> VoiceLeading::getTable(int root, int mode, bool sevenths)
+{
+    juce::int64 key = (((juce::int64)root * numModes + mode) * 2 + (sevenths ? 1 : 0)) * 128 * 128
+        + lowestNote * 128 + highestNote;
+
+    ICOF_BLOCKING_CALL("VoiceLeading::getTable");
+    const juce::ScopedLock scopedLock(lock);
+    auto found = tables.find(key);
+    if (found != tables.end())
+    {
+        found->second.lastUsed = ++useCounter;
+        return found->second.table;
+    }
+
+    if (pending.insert(key).second)
+    {
+        int low = lowestNote, high = highestNote;
+        pool.addJob([this, key, root, mode, sevenths, low, high]
+        {
+            std::shared_ptr<const VoiceLeadingTable> table = build(root, mode, sevenths, low, high);
+            const juce::ScopedLock scopedLock(lock);
+            if ((int)tables.size() >= maxTables)
+            {
+                auto oldest = std::min_element(tables.begin(), tables.end(),
+                    [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+                tables.erase(oldest);
+            }
+            tables[key] = { table, ++useCounter };
+            pending.erase(key);
+        });
+    }
+    return nullptr;
+}
+
+int VoiceLeading::distance(const VoiceLeadingTable::Voicing& from, const VoiceLeadingTable::Voicing& to)
+{
+    //Aligns the two sorted voicings, each voice moving to a note of the other chord and none
+    //crossing, the way two sequences are aligned: cost[i][j] covers the first i + 1 and j + 1 notes
+    int cost[4][4];
+    for (int i = 0; i < from.numNotes; i++)
+    {
+        for (int j = 0; j < to.numNotes; j++)
+        {
+            int move = std::abs(from.notes[i] - to.notes[j]);
+            if (i == 0 && j == 0)
+                cost[i][j] = move;
+            else if (i == 0)
+                cost[i][j] = move + cost[i][j - 1];
+            else if (j == 0)
+                cost[i][j] = move + cost[i - 1][j];
+            else
+                cost[i][j] = move + std::min({ cost[i - 1][j - 1], cost[i - 1][j], cost[i][j - 1] });
+        }
+    }
+    return cost[from.numNotes - 1][to.numNotes - 1];
+}
+
+std::shared_ptr<const VoiceLeadingTable> VoiceLeading::build(int root, int mode, bool sevenths, int lowestNote, int highestNote)
+{
+    auto table = std::make_shared<VoiceLeadingTable>();
+
+    //Every way of picking one of each chord note within the range, in every inversion and spread
+    for (int degree = 0; degree < 7; degree++)
+    {
+        int offsets[4];
+        int numNotes = diatonicChordOffsets(mode, degree, sevenths, offsets);
+        std::vector<int> candidates[4];
+        for (int idx = 0; idx < numNotes; idx++)
+        {
+            for (int note = lowestNote + pitchClass(root + offsets[idx] - lowestNote); note <= highestNote; note += 12)
+                candidates[idx].push_back(note);
+        }
+
+        int choice[4] = {};
+        while (true)
+        {
+            VoiceLeadingTable::Voicing voicing;
+            voicing.numNotes = numNotes;
+            for (int idx = 0; idx < numNotes; idx++)
+                voicing.notes[idx] = (juce::int8)candidates[idx][(size_t)choice[idx]];
+            std::sort(voicing.notes, voicing.notes + numNotes);
+            //Within an octave and a half keeps them playable and the table small
+            if (voicing.notes[numNotes - 1] - voicing.notes[0] <= 19)
+                table->voicings[degree].push_back(voicing);
+
+            int idx = 0;
+            while (idx < numNotes && ++choice[idx] == (int)candidates[idx].size())
+                choice[idx++] = 0;
+            if (idx == numNotes)
+                break;
+        }
+    }
+
+    for (int from = 0; from < 7; from++)
+    {
+        for (int to = 0; to < 7; to++)
+        {
+            int best = std::numeric_limits<int>::max();
+            table->bestFrom[from][to] = table->bestTo[from][to] = 0;
+            for (int i = 0; i < (int)table->voicings[from].size(); i++)
+            {
+                for (int j = 0; j < (int)table->voicings[to].size(); j++)
+                {
+                    int moved = distance(table->voicings[from][(size_t)i], table->voicings[to][(size_t)j]);
+                    if (moved < best)
+                    {
+                        best = moved;
+                        table->bestFrom[from][to] = i;
+                        table->bestTo[from][to] = j;
+                    }
+                }
+            }
+            table->distance[from][to] = best;
+        }
+    }
+    return table;
+}
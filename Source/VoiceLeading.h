@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+   This file is part of the InteractiveCircleOfFifths plugin code.
+   Copyright (c) Brynjar Reynisson
+
+   The code included in this file is provided under the terms of the ISC license
+   http://www.isc.org/downloads/software-support-policy/isc-license. Permission
+   to use, copy, modify, and/or distribute this software for any purpose with or
+   without fee is hereby granted provided that the above copyright notice and
+   this permission notice appear in all copies.
+
+   THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+   REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+   AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+   INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+   LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+   OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+   PERFORMANCE OF THIS SOFTWARE.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "MusicTheory.h"
+
+//==============================================================================
+// How far the voices have to move between the diatonic chords of a root and mode.
+struct VoiceLeadingTable
+{
+    struct Voicing
+    {
+        juce::int8 notes[4];    // lowest first
+        int numNotes;
+    };
+
+    // Every voicing within the note range of the chord on each degree
+    std::vector<Voicing> voicings[7];
+    // Fewest semitones moved, summed over the voices, from any voicing of one chord to any of another
+    int distance[7][7];
+    // The voicings that move the least, as indices into voicings
+    int bestFrom[7][7];
+    int bestTo[7][7];
+};
+
+//==============================================================================
+// Works out and caches a VoiceLeadingTable per root, mode and note range.
+//
+// Tables are built on a background thread the first time they are asked for,
+// so the editor can look them up as often as it likes while the mouse moves.
+// The least recently asked for go once there are more than maxTables.
+class VoiceLeading
+{
+public:
+    VoiceLeading();
+    ~VoiceLeading();
+
+    // Message thread. nullptr until the table has been built, try again later.
+    std::shared_ptr<const VoiceLeadingTable> getTable(int root, int mode, bool sevenths);
+
+    void setRange(int lowestNote, int highestNote);
+    int getLowestNote() const { return lowestNote; }
+    int getHighestNote() const { return highestNote; }
+
+    // Semitones the voices move between two voicings. Voices may merge or split
+    // when the number of notes differs.
+    static int distance(const VoiceLeadingTable::Voicing& from, const VoiceLeadingTable::Voicing& to);
+
+private:
+    static std::shared_ptr<const VoiceLeadingTable> build(int root, int mode, bool sevenths, int lowestNote, int highestNote);
+
+    int lowestNote = 48;
+    int highestNote = 72;
+
+    struct Cached
+    {
+        std::shared_ptr<const VoiceLeadingTable> table;
+        juce::int64 lastUsed;
+    };
+
+    juce::CriticalSection lock;
+    std::map<juce::int64, Cached> tables;
+    juce::int64 useCounter = 0;
+    std::set<juce::int64> pending;
+    juce::ThreadPool pool{ 1 };
+    static constexpr int maxTables = 48;
+};